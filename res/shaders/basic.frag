@@ -1,11 +1,12 @@
 #version 330 core
 
-in vec2 v_uvs;
+in vec3 v_uvs;
 in vec3 v_normal;
+in float v_ao;
 
 uniform vec3 u_color;
 uniform vec3 u_lightDir;
-uniform sampler2D u_texture;
+uniform sampler2DArray u_texture;
 
 out vec4 out_color;
 
@@ -16,6 +17,6 @@ void main() {
     light *= 0.5f;
     light = 0.8 * sqrt(light) + 0.18;
     vec4 color = texture(u_texture, v_uvs);
-    out_color = color * light;
+    out_color = color * light * v_ao;
     // out_color = vec4(vec3(light), 1.0);
 }
@@ -1,13 +1,15 @@
 #version 330 core
 
-layout(location=0) in vec4 pos;
-layout(location=1) in vec2 uvs;
-layout(location=2) in float id;
+// packed vertex, see PackedVertex in src/Mesher.h
+layout(location=0) in uint data;
+// one per draw, see ChunkRenderer, w is the level of detail of the mesh
+layout(location=1) in ivec4 chunkOrigin;
 
 uniform mat4 u_MVP;
 
-out vec2 v_uvs;
+out vec3 v_uvs;
 out vec3 v_normal;
+out float v_ao;
 
 vec3 normals[] = vec3[](
     vec3(0.0, 0.0, 1.0),
@@ -18,10 +20,30 @@ vec3 normals[] = vec3[](
     vec3(0.0, -1.0, 0.0)
 );
 
+float aoLevels[] = float[](0.45, 0.65, 0.85, 1.0);
+
+// the texture repeats every voxel, so the uvs are the position along the face axes
+vec2 faceUvs(uint face, vec3 pos) {
+    switch (face) {
+        case 0u: return pos.yx;
+        case 1u: return pos.xy;
+        case 2u: return pos.zy;
+        case 3u: return pos.yz;
+        case 4u: return pos.zx;
+        default: return pos.xz;
+    }
+}
+
 void main() {
-    v_normal = normals[uint(id)];
-    v_uvs = uvs;
-    vec3 vertexPosition = pos.xyz;
+    vec3 pos = vec3(data & 63u, (data >> 6) & 63u, (data >> 12) & 63u);
+    uint face = (data >> 18) & 7u;
+    uint ao = (data >> 21) & 3u;
+    uint layer = data >> 23;
+
+    v_normal = normals[face];
+    v_uvs = vec3(faceUvs(face, pos), float(layer));
+    v_ao = aoLevels[ao];
+    vec3 vertexPosition = vec3(chunkOrigin.xyz) + pos * float(1 << chunkOrigin.w);
 
     gl_Position = u_MVP * vec4(vertexPosition, 1.0);
     // gl_Position = vec4(vertexPosition, 1.0);
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+#include "BlockRegistry.h"
+
+// a single voxel, its properties are looked up in the BlockRegistry by id
+struct Block {
+    uint16_t id;
+
+    bool operator==(const Block&) const = default;
+
+    const BlockType& type() const { return BlockRegistry::get(id); }
+    bool opaque() const { return type().opaque; }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "WorldConstants.h"
+
+enum class Transparency : uint8_t {
+    invisible,   // not rendered at all (air)
+    transparent, // rendered, doesn't hide its neighbours (glass)
+    opaque,      // rendered, hides the faces of its neighbours
+};
+
+// indices into the block texture array, the order matches TEXTURE_LAYER_PATHS
+enum class TextureLayer : uint8_t {
+    dev = 0,
+    devTop,
+    devSide,
+    devBottom,
+    count
+};
+constexpr int TEXTURE_LAYER_COUNT = (int)TextureLayer::count;
+
+constexpr const char* TEXTURE_LAYER_PATHS[TEXTURE_LAYER_COUNT] = {
+    "res/dev.jpg",
+    "res/dev_t.jpg",
+    "res/dev_s.jpg",
+    "res/dev_b.jpg",
+};
+
+struct BlockType {
+    Transparency transparency;
+    bool opaque; // cached transparency == opaque, the mesher reads it for every voxel
+    bool solid;  // collides with entities
+    uint8_t topLayer, sideLayer, bottomLayer; // TextureLayer values
+};
+
+namespace BlockRegistry {
+    constexpr int TYPE_COUNT = 256; // ids above fall back to the last entry
+
+    constexpr BlockType makeType(Transparency transparency, bool solid, TextureLayer top, TextureLayer side, TextureLayer bottom) {
+        return {transparency, transparency == Transparency::opaque, solid, (uint8_t)top, (uint8_t)side, (uint8_t)bottom};
+    }
+    constexpr BlockType makeType(Transparency transparency, bool solid, TextureLayer layer) {
+        return makeType(transparency, solid, layer, layer, layer);
+    }
+
+    constexpr std::array<BlockType, TYPE_COUNT> makeTypes() {
+        std::array<BlockType, TYPE_COUNT> types{};
+        // first 24 ids are reserved for transparent blocks
+        for (int id = 0; id < TYPE_COUNT; id++) {
+            types[id] = makeType(id < Consts::BlockIDs::dirt ? Transparency::transparent : Transparency::opaque, true, TextureLayer::dev);
+        }
+        types[Consts::BlockIDs::air]   = makeType(Transparency::invisible, false, TextureLayer::dev);
+        types[Consts::BlockIDs::glass] = makeType(Transparency::transparent, true, TextureLayer::dev);
+        types[Consts::BlockIDs::dirt]  = makeType(Transparency::opaque, true, TextureLayer::devBottom);
+        types[Consts::BlockIDs::stone] = makeType(Transparency::opaque, true, TextureLayer::dev);
+        types[Consts::BlockIDs::grass] = makeType(Transparency::opaque, true, TextureLayer::devTop, TextureLayer::devSide, TextureLayer::devBottom);
+        return types;
+    }
+
+    constexpr std::array<BlockType, TYPE_COUNT> TYPES = makeTypes();
+
+    constexpr const BlockType& get(uint16_t id) {
+        return TYPES[id < TYPE_COUNT ? id : TYPE_COUNT - 1];
+    }
+
+    // opacity and visibility packed in a byte per type for the meshers' inner loops
+    constexpr uint8_t FLAG_OPAQUE = 0b01;
+    constexpr uint8_t FLAG_VISIBLE = 0b10;
+    constexpr std::array<uint8_t, TYPE_COUNT> makeFlags() {
+        std::array<uint8_t, TYPE_COUNT> flags{};
+        for (int id = 0; id < TYPE_COUNT; id++) {
+            flags[id] = (TYPES[id].opaque ? FLAG_OPAQUE : 0)
+                | (TYPES[id].transparency != Transparency::invisible ? FLAG_VISIBLE : 0);
+        }
+        return flags;
+    }
+    constexpr std::array<uint8_t, TYPE_COUNT> FLAGS = makeFlags();
+
+    constexpr uint8_t flags(uint16_t id) {
+        return FLAGS[id < TYPE_COUNT ? id : TYPE_COUNT - 1];
+    }
+
+    // whether the face of block between it and its neighbour should be rendered
+    constexpr bool faceVisible(uint16_t block, uint16_t neighbour) {
+        const BlockType& type = get(block);
+        if (type.transparency == Transparency::invisible || get(neighbour).opaque) {
+            return false;
+        }
+        // neighbouring glass blocks merge into one volume
+        return type.transparency == Transparency::opaque || block != neighbour;
+    }
+}
@@ -0,0 +1,151 @@
+#include "ChunkCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define CODEC_SSE2 1
+#endif
+
+#include "tracy/Tracy.hpp"
+
+
+// the index repeated over a whole word, bits has to be 1..16
+static uint64_t repeat(unsigned int index, int bits) {
+    return index * (~0ull / ((1ull << bits) - 1));
+}
+
+static void putRun(std::vector<uint8_t>& out, unsigned int index, bool wide, int length) {
+    if (wide) {
+        out.push_back(index & 0xFF);
+        out.push_back(index >> 8);
+    } else {
+        out.push_back(index);
+    }
+    unsigned int n = length - 1;
+    if (n < ChunkCodec::SHORT_RUN) {
+        out.push_back(n);
+    } else {
+        out.push_back(0x80 | (n >> 8));
+        out.push_back(n & 0xFF);
+    }
+}
+
+// sets the indices [begin, end) of zeroed words to the index
+static void fillRun(uint64_t* words, int bits, int begin, int end, unsigned int index) {
+    const uint64_t pattern = repeat(index, bits);
+    size_t bit = (size_t)begin * bits, endBit = (size_t)end * bits;
+    size_t first = bit >> 6, last = (endBit - 1) >> 6;
+    uint64_t head = ~0ull << (bit & 63);
+    uint64_t tail = ~0ull >> (63 - ((endBit - 1) & 63));
+    if (first == last) {
+        words[first] |= pattern & head & tail;
+        return;
+    }
+    words[first] |= pattern & head;
+    size_t w = first + 1;
+#ifdef CODEC_SSE2
+    const __m128i fill = _mm_set1_epi64x((long long)pattern);
+    for (; w + 2 <= last; w += 2) {
+        _mm_storeu_si128((__m128i*)(words + w), fill);
+    }
+#endif
+    for (; w < last; w++) {
+        words[w] = pattern;
+    }
+    words[last] |= pattern & tail;
+}
+
+void ChunkCodec::encode(const ChunkStorage& chunk, std::vector<uint8_t>& out) {
+    ZoneScopedN("ChunkCodec::encode");
+    const std::vector<Block>& palette = chunk.palette_;
+    out.resize(2 + palette.size() * sizeof(Block));
+    uint16_t paletteSize = palette.size();
+    std::memcpy(out.data(), &paletteSize, 2);
+    std::memcpy(out.data() + 2, palette.data(), palette.size() * sizeof(Block));
+    const bool wide = palette.size() > 256;
+
+    const int bits = chunk.bits_;
+    if (bits == 0) {
+        putRun(out, 0, wide, Consts::CHUNK_SIZE_POW3);
+        return;
+    }
+    const int perWord = 64 / bits;
+    unsigned int current = chunk.readIndex(0);
+    uint64_t currentWord = repeat(current, bits);
+    int length = 0;
+    int i = 0;
+    while (i < Consts::CHUNK_SIZE_POW3) {
+        // a word holding only the current index continues the run as a whole
+        if (i % perWord == 0 && chunk.data_[i / perWord] == currentWord) {
+            length += perWord;
+            i += perWord;
+            continue;
+        }
+        unsigned int index = chunk.readIndex(i);
+        if (index != current) {
+            putRun(out, current, wide, length);
+            current = index;
+            currentWord = repeat(current, bits);
+            length = 0;
+        }
+        length++;
+        i++;
+    }
+    putRun(out, current, wide, length);
+}
+
+bool ChunkCodec::decode(const uint8_t* data, size_t size, ChunkStorage& out) {
+    ZoneScopedN("ChunkCodec::decode");
+    const uint8_t* end = data + size;
+    if (size < 2) {
+        return false;
+    }
+    uint16_t paletteSize;
+    std::memcpy(&paletteSize, data, 2);
+    data += 2;
+    if (paletteSize == 0 || (size_t)(end - data) < paletteSize * sizeof(Block)) {
+        return false;
+    }
+    const uint8_t* palette = data;
+    data += paletteSize * sizeof(Block);
+    const bool wide = paletteSize > 256;
+    const int bits = ChunkStorage::bitsFor(paletteSize);
+
+    static thread_local std::vector<uint64_t> words;
+    words.assign(Consts::CHUNK_SIZE_POW3 * bits / 64, 0);
+    int pos = 0;
+    while (pos < Consts::CHUNK_SIZE_POW3) {
+        if (end - data < (wide ? 3 : 2)) {
+            return false;
+        }
+        unsigned int index = wide ? data[0] | (data[1] << 8) : data[0];
+        data += wide ? 2 : 1;
+        int length = *data++ + 1;
+        if (length > SHORT_RUN) {
+            if (data == end) {
+                return false;
+            }
+            length = (((length - 1) & 0x7F) << 8 | *data++) + 1;
+        }
+        if (index >= paletteSize || length > Consts::CHUNK_SIZE_POW3 - pos) {
+            return false;
+        }
+        if (index != 0) {
+            fillRun(words.data(), bits, pos, pos + length, index);
+        }
+        pos += length;
+    }
+    if (data != end) {
+        return false;
+    }
+
+    out.palette_.resize(paletteSize);
+    std::memcpy(out.palette_.data(), palette, paletteSize * sizeof(Block));
+    out.data_.assign(words.begin(), words.end());
+    out.data_.shrink_to_fit();
+    out.bits_ = bits;
+    out.updateBricks();
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ChunkStorage.h"
+
+/*
+ * Run length compression of a chunk for the disk and for chunks far from the camera
+ *
+ * The voxels are walked in index order (x is the fastest varying axis) and stored as runs
+ * of palette indices: u16 palette size, the palette ids (u16 each), then for every run the
+ * palette index (u8, u16 when the palette has more than 256 blocks) and the length
+ * (1 byte up to 128, 2 bytes up to a whole chunk). Terrain is made of long runs of air
+ * and stone, so most chunks shrink to a few hundred bytes.
+ *
+ * Runs are decoded straight into the packed index words of the chunk storage. The words
+ * a run covers whole are filled with the index repeated over the word, 128 bits a store,
+ * and runs of the first palette block (air, mostly) are skipped as the words start zeroed.
+ */
+class ChunkCodec {
+public:
+    // the longest run that fits a single byte
+    static constexpr int SHORT_RUN = 128;
+
+    // replaces out with the compressed chunk
+    static void encode(const ChunkStorage& chunk, std::vector<uint8_t>& out);
+    // replaces the chunk with compressed data, returns false (and keeps the chunk) when it's malformed
+    static bool decode(const uint8_t* data, size_t size, ChunkStorage& out);
+};
@@ -0,0 +1,170 @@
+#include "ChunkIO.h"
+
+#include <algorithm>
+
+#include "ChunkCodec.h"
+#include "tracy/Tracy.hpp"
+
+
+ChunkIO::ChunkIO(RegionStore& store, std::unique_ptr<IOBackend> backend, ThreadPool& pool)
+    : store_(store), backend_(std::move(backend)), pool_(pool), center_(0, 0, 0), cancelled_(0),
+      reading_(0), decoding_(0)
+{
+}
+
+ChunkIO::~ChunkIO() {
+    // the backend and the workers still write into the requests
+    while (reading_ > 0) {
+        poll(true);
+    }
+    std::unique_lock<std::mutex> lock(decodedMutex_);
+    decodedCond_.wait(lock, [this] { return (int)decoded_.size() == decoding_; });
+}
+
+int ChunkIO::distance2(glm::ivec3 chunkPos) const {
+    glm::ivec3 d = chunkPos - center_;
+    return d.x*d.x + d.y*d.y + d.z*d.z;
+}
+
+bool ChunkIO::request(glm::ivec3 chunkPos) {
+    auto it = requests_.find(chunkPos);
+    if (it != requests_.end()) {
+        if (it->second->cancelled) {
+            it->second->cancelled = false;
+            cancelled_--;
+        }
+        return true;
+    }
+    int fd;
+    RegionFile::Entry entry;
+    if (!store_.locate(chunkPos, fd, entry)) {
+        return false;
+    }
+    auto request = std::make_unique<Request>();
+    request->chunkPos = chunkPos;
+    request->bytes.resize(entry.size);
+    request->read = {fd, entry.offset, entry.size, request->bytes.data(), request.get(), 0};
+    request->queued = true;
+    request->cancelled = false;
+    requests_.emplace(chunkPos, std::move(request));
+    queue_.push_back(chunkPos);
+    std::push_heap(queue_.begin(), queue_.end(), [this](glm::ivec3 a, glm::ivec3 b) { return farther(a, b); });
+    return true;
+}
+
+void ChunkIO::cancel(glm::ivec3 chunkPos) {
+    auto it = requests_.find(chunkPos);
+    if (it == requests_.end() || it->second->cancelled) {
+        return;
+    }
+    // queued ones can go right away, their heap entry is skipped later
+    if (it->second->queued) {
+        requests_.erase(it);
+        return;
+    }
+    it->second->cancelled = true;
+    cancelled_++;
+}
+
+void ChunkIO::cancelAll() {
+    for (auto it = requests_.begin(); it != requests_.end();) {
+        if (it->second->queued) {
+            it = requests_.erase(it);
+            continue;
+        }
+        if (!it->second->cancelled) {
+            it->second->cancelled = true;
+            cancelled_++;
+        }
+        ++it;
+    }
+    queue_.clear();
+}
+
+void ChunkIO::setCenter(glm::ivec3 center, int radius) {
+    ZoneScopedN("ChunkIO::setCenter");
+    center_ = center;
+    std::vector<glm::ivec3> outside;
+    queue_.clear();
+    for (auto& [chunkPos, request] : requests_) {
+        if (distance2(chunkPos) > radius*radius) {
+            outside.push_back(chunkPos);
+        } else if (request->queued) {
+            queue_.push_back(chunkPos);
+        }
+    }
+    for (glm::ivec3 chunkPos : outside) {
+        cancel(chunkPos);
+    }
+    std::make_heap(queue_.begin(), queue_.end(), [this](glm::ivec3 a, glm::ivec3 b) { return farther(a, b); });
+}
+
+bool ChunkIO::isPending(glm::ivec3 chunkPos) const {
+    auto it = requests_.find(chunkPos);
+    return it != requests_.end() && !it->second->cancelled;
+}
+
+void ChunkIO::poll(bool wait) {
+    done_.clear();
+    backend_->poll(done_, wait);
+    reading_ -= done_.size();
+    for (IOBackend::Read* read : done_) {
+        Request* request = (Request*)read->user;
+        decoding_++;
+        pool_.submit([this, request] {
+            const IOBackend::Read& read = request->read;
+            request->storage = std::make_unique<ChunkStorage>();
+            if (read.result != (int)read.size || !ChunkCodec::decode(read.buffer, read.size, *request->storage)) {
+                request->storage.reset();
+            }
+            // notified under the lock, the destructor may return as soon as it's released
+            std::lock_guard<std::mutex> lock(decodedMutex_);
+            decoded_.push_back(request);
+            decodedCond_.notify_one();
+        });
+    }
+}
+
+int ChunkIO::collect(std::vector<Loaded>& loaded, int maxLoaded) {
+    ZoneScopedN("ChunkIO::collect");
+    // the nearest queued chunks go first, the backend hands them to the system in poll
+    auto farther = [this](glm::ivec3 a, glm::ivec3 b) { return this->farther(a, b); };
+    while (reading_ < MAX_IN_FLIGHT && !queue_.empty()) {
+        std::pop_heap(queue_.begin(), queue_.end(), farther);
+        glm::ivec3 chunkPos = queue_.back();
+        queue_.pop_back();
+        auto it = requests_.find(chunkPos);
+        if (it == requests_.end() || !it->second->queued) {
+            continue;
+        }
+        it->second->queued = false;
+        reading_++;
+        backend_->submit(&it->second->read);
+    }
+    poll(false);
+
+    // the rest waits in decoded_ for the next call
+    collected_.clear();
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex_);
+        // cancelled ones don't count
+        int count = 0;
+        for (size_t i = 0; i < decoded_.size() && count < maxLoaded; i++) {
+            count += !decoded_[i]->cancelled;
+            collected_.push_back(decoded_[i]);
+        }
+        decoded_.erase(decoded_.begin(), decoded_.begin() + collected_.size());
+        decoding_ -= collected_.size();
+    }
+    int count = 0;
+    for (Request* request : collected_) {
+        if (request->cancelled) {
+            cancelled_--;
+        } else {
+            loaded.push_back({request->chunkPos, std::move(request->storage)});
+            count++;
+        }
+        requests_.erase(request->chunkPos);
+    }
+    return count;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "ChunkStorage.h"
+#include "IOBackend.h"
+#include "RegionStore.h"
+#include "ThreadPool.h"
+
+/*
+ * Reads saved chunks off the main thread
+ *
+ * Requests wait in a queue ordered by the distance to the center, at most MAX_IN_FLIGHT
+ * of them are read at a time so a newly requested near chunk doesn't wait for a long
+ * queue of far ones. Read chunks are decompressed on the thread pool, the main thread
+ * only collects the finished storages.
+ *
+ * A cancelled request that is already being read is dropped once it's done, requesting
+ * it again before that just keeps it.
+ */
+class ChunkIO {
+public:
+    static constexpr int MAX_IN_FLIGHT = 32;
+
+    struct Loaded {
+        glm::ivec3 chunkPos;
+        std::unique_ptr<ChunkStorage> storage; // nullptr when the chunk couldn't be read
+    };
+
+private:
+    struct Request {
+        glm::ivec3 chunkPos;
+        IOBackend::Read read;
+        std::vector<uint8_t> bytes;
+        std::unique_ptr<ChunkStorage> storage;
+        bool queued;    // waiting for its turn to be read
+        bool cancelled;
+    };
+
+    RegionStore& store_;
+    std::unique_ptr<IOBackend> backend_;
+    ThreadPool& pool_;
+    glm::ivec3 center_;
+    // requested and not collected yet, cancelled ones included
+    std::unordered_map<glm::ivec3, std::unique_ptr<Request>> requests_;
+    int cancelled_;
+    // positions of the queued requests, a heap with the nearest on top (may hold stale ones)
+    std::vector<glm::ivec3> queue_;
+    int reading_;  // submitted to the backend
+    int decoding_; // handed to the thread pool
+
+    std::mutex decodedMutex_;
+    std::condition_variable decodedCond_;
+    std::vector<Request*> decoded_;
+    // kept to reuse the memory
+    std::vector<IOBackend::Read*> done_;
+    std::vector<Request*> collected_;
+
+public:
+    ChunkIO(RegionStore& store, std::unique_ptr<IOBackend> backend = IOBackend::create(), ThreadPool& pool = ThreadPool::instance());
+    ~ChunkIO();
+    ChunkIO(const ChunkIO&) = delete;
+    ChunkIO& operator=(const ChunkIO&) = delete;
+
+    // queues the chunk for reading, returns false if it isn't saved
+    bool request(glm::ivec3 chunkPos);
+    // the chunk won't be returned by collect
+    void cancel(glm::ivec3 chunkPos);
+    void cancelAll();
+    // orders the queue by the distance to center and cancels the requests further than radius
+    void setCenter(glm::ivec3 center, int radius);
+    // starts the next reads and appends at most maxLoaded of the chunks read since to loaded
+    int collect(std::vector<Loaded>& loaded, int maxLoaded = INT_MAX);
+
+    bool isPending(glm::ivec3 chunkPos) const;
+    int pending() const { return requests_.size() - cancelled_; }
+    IOBackend::Kind backend() const { return backend_->kind(); }
+
+private:
+    int distance2(glm::ivec3 chunkPos) const;
+    // orders the heap, the nearest chunk has to end up on top
+    bool farther(glm::ivec3 a, glm::ivec3 b) const { return distance2(a) > distance2(b); }
+    // moves the finished reads to the thread pool, with wait blocks until there's one
+    void poll(bool wait);
+};
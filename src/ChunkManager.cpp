@@ -0,0 +1,468 @@
+#include "ChunkManager.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "ChunkCodec.h"
+#include "tracy/Tracy.hpp"
+#include "World.h"
+#include "WorldConstants.h"
+
+
+ChunkManager::ChunkManager(const TerrainGenerator& generator, RegionStore* store, int radius)
+    : terrain_(generator), store_(store), io_(store ? std::make_unique<ChunkIO>(*store) : nullptr),
+      meshes_(&staging_), radius_(radius), meshingMode_(MeshingMode::greedy),
+      center_(0, 0, 0), centered_(false), compressFar_(true), compressedBytes_(0), visibleCount_(0), culledCount_(0),
+      farField_(glm::ivec3(-(1 << (FAR_FIELD_LEVELS - 1))), FAR_FIELD_LEVELS)
+{
+    // edits of compressed chunks decompress them first, edits of chunks still on the way load them
+    World::setChunkSource([this](glm::ivec3 chunkPos) -> ChunkStorage* {
+        if (compressed_.contains(chunkPos)) {
+            decompress(chunkPos);
+            return World::getChunk(chunkPos);
+        }
+        if (centered_ && !loaded_.contains(chunkPos) && inRadius(chunkPos, radius_ + 2)) {
+            return claim(chunkPos);
+        }
+        return nullptr;
+    });
+    // reads decode a copy and leave them compressed
+    World::setChunkReader([this](glm::ivec3 chunkPos, ChunkStorage& out) {
+        auto it = compressed_.find(chunkPos);
+        return it != compressed_.end() && ChunkCodec::decode(it->second.data(), it->second.size(), out);
+    });
+}
+
+ChunkManager::~ChunkManager() {
+    World::setChunkSource(nullptr);
+    World::setChunkReader(nullptr);
+    clear();
+}
+
+void ChunkManager::clear() {
+    save();
+    if (!unsaved_.empty()) {
+        std::cerr << "Failed to save " << unsaved_.size() << " chunks, their changes are lost" << std::endl;
+        unsaved_.clear();
+    }
+    terrain_.cancelAll();
+    if (io_) {
+        io_->cancelAll();
+    }
+    for (auto& [chunkPos, meshed] : chunks_) {
+        meshes_.forget(chunkPos);
+    }
+    chunks_.clear();
+    toRemesh_.clear();
+    for (glm::ivec3 chunkPos : farFieldStale_) {
+        farField_.insertChunk(chunkPos, *World::getChunk(chunkPos));
+    }
+    farFieldStale_.clear();
+    for (glm::ivec3 chunkPos : loaded_) {
+        World::removeChunk(chunkPos);
+    }
+    loaded_.clear();
+    compressed_.clear();
+    compressedBytes_ = 0;
+    toLoad_.clear();
+    claimed_.clear();
+    centered_ = false;
+}
+
+int ChunkManager::save() {
+    if (!store_) {
+        return 0;
+    }
+    ZoneScopedN("ChunkManager::save");
+    int saved = 0;
+    for (auto it = unsaved_.begin(); it != unsaved_.end();) {
+        ChunkStorage& chunk = *World::getChunk(*it);
+        // palettes only grow while the blocks are edited
+        if (farFieldStale_.contains(*it)) {
+            chunk.compact();
+        }
+        // the ones that failed are tried again on the next save
+        if (store_->save(*it, chunk)) {
+            it = unsaved_.erase(it);
+            saved++;
+        } else {
+            ++it;
+        }
+    }
+    return saved;
+}
+
+void ChunkManager::setCompressFar(bool compress) {
+    compressFar_ = compress;
+    if (compress) {
+        for (glm::ivec3 chunkPos : loaded_) {
+            if (!inRadius(chunkPos, radius_ + 2) && !compressed_.contains(chunkPos)) {
+                this->compress(chunkPos);
+            }
+        }
+    } else {
+        while (!compressed_.empty()) {
+            decompress(compressed_.begin()->first);
+        }
+    }
+}
+
+void ChunkManager::compress(glm::ivec3 chunkPos) {
+    ChunkStorage* chunk = World::getChunk(chunkPos);
+    // edited, its palette may hold blocks that are gone
+    if (farFieldStale_.erase(chunkPos)) {
+        chunk->compact();
+        farField_.insertChunk(chunkPos, *chunk);
+    }
+    // only the World copy is written on save, this one would be lost,
+    // so it stays in the World until it's written
+    if (unsaved_.contains(chunkPos)) {
+        if (!store_->save(chunkPos, *chunk)) {
+            return;
+        }
+        unsaved_.erase(chunkPos);
+    }
+    std::vector<uint8_t>& bytes = compressed_[chunkPos];
+    ChunkCodec::encode(*chunk, bytes);
+    bytes.shrink_to_fit();
+    compressedBytes_ += bytes.size();
+    World::removeChunk(chunkPos);
+}
+
+void ChunkManager::decompress(glm::ivec3 chunkPos) {
+    auto it = compressed_.find(chunkPos);
+    auto chunk = std::make_unique<ChunkStorage>();
+    ChunkCodec::decode(it->second.data(), it->second.size(), *chunk);
+    World::insertChunk(chunkPos, std::move(chunk));
+    compressedBytes_ -= it->second.size();
+    compressed_.erase(it);
+}
+
+ChunkStorage* ChunkManager::claim(glm::ivec3 chunkPos) {
+    ZoneScopedN("ChunkManager::claim");
+    // the generated or read chunk would replace the edited one when it's done
+    terrain_.cancel(chunkPos);
+    if (io_) {
+        io_->cancel(chunkPos);
+    }
+    auto chunk = std::make_unique<ChunkStorage>();
+    bool read = store_ && store_->load(chunkPos, *chunk);
+    if (!read) {
+        terrain_.generator().generate(chunkPos, *chunk);
+        if (store_) {
+            unsaved_.insert(chunkPos);
+        }
+    }
+    ChunkStorage& storage = World::insertChunk(chunkPos, std::move(chunk));
+    loaded_.insert(chunkPos);
+    farField_.insertChunk(chunkPos, storage);
+    // meshing gathers from the World, it waits until the edit is done
+    claimed_.push_back(chunkPos);
+    return &storage;
+}
+
+bool ChunkManager::inRadius(glm::ivec3 chunkPos, int radius) const {
+    glm::ivec3 d = chunkPos - center_;
+    return d.x*d.x + d.y*d.y + d.z*d.z <= radius*radius;
+}
+
+void ChunkManager::update(glm::vec3 cameraPos) {
+    ZoneScopedN("ChunkManager::update");
+    glm::ivec3 center = World::toChunkPos(glm::ivec3(glm::floor(cameraPos)));
+    if (!centered_ || center != center_) {
+        recenter(center);
+    }
+
+    // saved chunks are read, the rest is generated, keeping only a couple of batches
+    // in flight so the nearest chunks aren't stuck behind far ones
+    inserted_.clear();
+    int scheduled = 0, requested = 0;
+    while (!toLoad_.empty() && scheduled < (int)Consts::CHUNK_TOLOAD_BATCH && requested < READ_BATCH
+            && terrain_.pending() < 2 * (int)Consts::CHUNK_TOLOAD_BATCH && readingCount() < 2 * READ_BATCH) {
+        glm::ivec3 chunkPos = toLoad_.back();
+        toLoad_.pop_back();
+        if (loaded_.contains(chunkPos)) {
+            continue;
+        }
+        if (io_ && io_->request(chunkPos)) {
+            requested++;
+        } else if (terrain_.schedule(chunkPos)) {
+            scheduled++;
+        }
+    }
+
+    int read = 0;
+    if (io_) {
+        read_.clear();
+        io_->collect(read_, READ_BATCH);
+        for (ChunkIO::Loaded& loaded : read_) {
+            // unreadable chunks are generated again
+            if (!loaded.storage) {
+                terrain_.schedule(loaded.chunkPos);
+                continue;
+            }
+            World::insertChunk(loaded.chunkPos, std::move(loaded.storage));
+            inserted_.push_back(loaded.chunkPos);
+            read++;
+        }
+    }
+
+    // the generated chunks come after the read ones
+    terrain_.insert(inserted_);
+    for (size_t i = read; i < inserted_.size() && store_; i++) {
+        unsaved_.insert(inserted_[i]);
+    }
+    for (glm::ivec3 chunkPos : inserted_) {
+        loaded_.insert(chunkPos);
+        farField_.insertChunk(chunkPos, *World::getChunk(chunkPos));
+    }
+    for (glm::ivec3 chunkPos : inserted_) {
+        // finished after the camera moved away
+        if (!inRadius(chunkPos, radius_ + 3)) {
+            unload(chunkPos);
+            continue;
+        }
+        if (compressFar_ && !inRadius(chunkPos, radius_ + 2)) {
+            compress(chunkPos);
+            continue;
+        }
+        tryMeshAround(chunkPos);
+    }
+    for (glm::ivec3 chunkPos : claimed_) {
+        tryMeshAround(chunkPos);
+    }
+    claimed_.clear();
+
+    remeshDirty();
+    meshes_.upload();
+    renderer_.arena().compact(COMPACT_BUDGET);
+}
+
+void ChunkManager::remeshDirty() {
+    ZoneScopedN("ChunkManager::remeshDirty");
+    World::takeDirty(modified_, dirty_);
+    for (glm::ivec3 chunkPos : modified_) {
+        // edits outside of the streamed chunks aren't tracked
+        if (!loaded_.contains(chunkPos)) {
+            continue;
+        }
+        if (store_) {
+            unsaved_.insert(chunkPos);
+        }
+        farFieldStale_.insert(chunkPos);
+    }
+    for (glm::ivec3 chunkPos : dirty_) {
+        if (chunks_.contains(chunkPos)) {
+            toRemesh_.insert(chunkPos);
+        }
+    }
+    if (toRemesh_.empty()) {
+        return;
+    }
+
+    remeshing_.assign(toRemesh_.begin(), toRemesh_.end());
+    if ((int)remeshing_.size() > REMESH_BATCH) {
+        glm::ivec3 center = center_;
+        std::nth_element(remeshing_.begin(), remeshing_.begin() + REMESH_BATCH, remeshing_.end(), [center](glm::ivec3 a, glm::ivec3 b) {
+            glm::ivec3 da = a - center, db = b - center;
+            return da.x*da.x + da.y*da.y + da.z*da.z < db.x*db.x + db.y*db.y + db.z*db.z;
+        });
+        remeshing_.resize(REMESH_BATCH);
+    }
+    for (glm::ivec3 chunkPos : remeshing_) {
+        toRemesh_.erase(chunkPos);
+        Meshed& meshed = chunks_[chunkPos];
+        meshes_.schedule(meshed.chunk.get(), chunkPos, meshingMode_, meshed.lod, meshed.seams);
+    }
+}
+
+void ChunkManager::recenter(glm::ivec3 center) {
+    ZoneScopedN("ChunkManager::recenter");
+    center_ = center;
+    centered_ = true;
+    // the diagonal neighbours of the meshed chunks are up to sqrt(3) chunks further
+    int loadRadius = radius_ + 2;
+    if (io_) {
+        io_->setCenter(center, loadRadius);
+    }
+
+    std::vector<glm::ivec3> toUnload;
+    for (glm::ivec3 chunkPos : loaded_) {
+        if (!inRadius(chunkPos, radius_ + 3)) {
+            toUnload.push_back(chunkPos);
+        }
+    }
+    for (glm::ivec3 chunkPos : toUnload) {
+        unload(chunkPos);
+    }
+    if (compressFar_) {
+        ZoneScopedN("ChunkManager::compress");
+        std::vector<glm::ivec3> toDecompress;
+        for (auto& [chunkPos, bytes] : compressed_) {
+            if (inRadius(chunkPos, radius_ + 2)) {
+                toDecompress.push_back(chunkPos);
+            }
+        }
+        for (glm::ivec3 chunkPos : toDecompress) {
+            decompress(chunkPos);
+        }
+        for (glm::ivec3 chunkPos : loaded_) {
+            if (!inRadius(chunkPos, radius_ + 2) && !compressed_.contains(chunkPos)) {
+                compress(chunkPos);
+            }
+        }
+    }
+    updateLods();
+
+    toLoad_.clear();
+    for (int z = -loadRadius; z <= loadRadius; z++) {
+        for (int y = -loadRadius; y <= loadRadius; y++) {
+            for (int x = -loadRadius; x <= loadRadius; x++) {
+                glm::ivec3 chunkPos = center + glm::ivec3(x, y, z);
+                if (inRadius(chunkPos, loadRadius) && !loaded_.contains(chunkPos) && !terrain_.isPending(chunkPos)
+                        && !(io_ && io_->isPending(chunkPos))) {
+                    toLoad_.push_back(chunkPos);
+                }
+            }
+        }
+    }
+    std::sort(toLoad_.begin(), toLoad_.end(), [center](glm::ivec3 a, glm::ivec3 b) {
+        glm::ivec3 da = a - center, db = b - center;
+        return da.x*da.x + da.y*da.y + da.z*da.z > db.x*db.x + db.y*db.y + db.z*db.z;
+    });
+}
+
+void ChunkManager::tryMesh(glm::ivec3 chunkPos) {
+    if (chunks_.contains(chunkPos) || !loaded_.contains(chunkPos) || !inRadius(chunkPos, radius_)) {
+        return;
+    }
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                if (!loaded_.contains(chunkPos + glm::ivec3(x, y, z))) {
+                    return;
+                }
+            }
+        }
+    }
+    Meshed& meshed = chunks_[chunkPos];
+    meshed.chunk = std::make_unique<Chunk>(renderer_.arena(), chunkPos * Consts::CHUNK_SIZE);
+    meshed.lod = lodFor(chunkPos);
+    meshed.seams = seamsFor(chunkPos, meshed.lod);
+    meshes_.schedule(meshed.chunk.get(), chunkPos, meshingMode_, meshed.lod, meshed.seams);
+}
+
+void ChunkManager::tryMeshAround(glm::ivec3 chunkPos) {
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                tryMesh(chunkPos + glm::ivec3(x, y, z));
+            }
+        }
+    }
+}
+
+int ChunkManager::lodFor(glm::ivec3 chunkPos) const {
+    glm::ivec3 d = chunkPos - center_;
+    int distance2 = d.x*d.x + d.y*d.y + d.z*d.z;
+    int lod = 0;
+    while (lod < ChunkSnapshot::MAX_LOD && distance2 >= (Consts::LOD_DISTANCE << lod) * (Consts::LOD_DISTANCE << lod)) {
+        lod++;
+    }
+    return lod;
+}
+
+uint8_t ChunkManager::seamsFor(glm::ivec3 chunkPos, int lod) const {
+    // in the Mesher direction order
+    static const glm::ivec3 SIDES[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    uint8_t seams = 0;
+    for (int dir = 0; dir < 6; dir++) {
+        if (lodFor(chunkPos + SIDES[dir]) != lod) {
+            seams |= 1 << dir;
+        }
+    }
+    return seams;
+}
+
+void ChunkManager::updateLods() {
+    ZoneScopedN("ChunkManager::updateLods");
+    for (auto& [chunkPos, meshed] : chunks_) {
+        int lod = lodFor(chunkPos);
+        uint8_t seams = seamsFor(chunkPos, lod);
+        if (lod != meshed.lod || seams != meshed.seams) {
+            meshed.lod = lod;
+            meshed.seams = seams;
+            meshes_.schedule(meshed.chunk.get(), chunkPos, meshingMode_, lod, seams);
+        }
+    }
+}
+
+void ChunkManager::unload(glm::ivec3 chunkPos) {
+    if (farFieldStale_.erase(chunkPos)) {
+        ChunkStorage& chunk = *World::getChunk(chunkPos);
+        // saved compact
+        chunk.compact();
+        farField_.insertChunk(chunkPos, chunk);
+    }
+    // kept loaded until it's written, it's tried again on the next recenter
+    if (unsaved_.contains(chunkPos)) {
+        if (!store_->save(chunkPos, *World::getChunk(chunkPos))) {
+            return;
+        }
+        unsaved_.erase(chunkPos);
+    }
+    toRemesh_.erase(chunkPos);
+    meshes_.forget(chunkPos);
+    chunks_.erase(chunkPos);
+    terrain_.cancel(chunkPos);
+    if (io_) {
+        io_->cancel(chunkPos);
+    }
+    auto compressed = compressed_.find(chunkPos);
+    if (compressed != compressed_.end()) {
+        compressedBytes_ -= compressed->second.size();
+        compressed_.erase(compressed);
+    }
+    World::removeChunk(chunkPos);
+    loaded_.erase(chunkPos);
+}
+
+void ChunkManager::draw(const Frustum* frustum) {
+    ZoneScopedN("ChunkManager::draw");
+    drawList_.clear();
+    boxes_.clear();
+    for (auto& [chunkPos, meshed] : chunks_) {
+        const Chunk* chunk = meshed.chunk.get();
+        if (chunk->quadCount() == 0) {
+            continue;
+        }
+        drawList_.push_back(chunk);
+        glm::vec3 min = glm::vec3(chunk->position());
+        boxes_.add(min, min + glm::vec3((float)Consts::CHUNK_SIZE));
+    }
+
+    if (frustum) {
+        visibleCount_ = frustum->cull(boxes_, visible_);
+    } else {
+        visible_.assign(drawList_.size(), 1);
+        visibleCount_ = drawList_.size();
+    }
+    culledCount_ = drawList_.size() - visibleCount_;
+
+    renderer_.begin();
+    for (size_t i = 0; i < drawList_.size(); i++) {
+        if (visible_[i]) {
+            renderer_.add(*drawList_[i]);
+        }
+    }
+    renderer_.draw();
+}
+
+void ChunkManager::remeshAll(MeshingMode mode) {
+    ZoneScopedN("ChunkManager::remeshAll");
+    meshingMode_ = mode;
+    for (auto& [chunkPos, meshed] : chunks_) {
+        meshes_.schedule(meshed.chunk.get(), chunkPos, mode, meshed.lod, meshed.seams);
+    }
+    meshes_.finish();
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "Chunk.h"
+#include "ChunkIO.h"
+#include "ChunkRenderer.h"
+#include "Frustum.h"
+#include "MeshScheduler.h"
+#include "RegionStore.h"
+#include "SparseVoxelOctree.h"
+#include "StagingRing.h"
+#include "TerrainGenerator.h"
+#include "TerrainScheduler.h"
+
+/*
+ * Streams chunks in and out around the camera
+ *
+ * Chunks within radius + 2 are generated nearest first, CHUNK_TOLOAD_BATCH a frame.
+ * Chunks within radius are meshed once all their neighbours exist (so the faces on the
+ * border are right the first time). Chunks further than radius + 3 are unloaded from
+ * the World and the gpu, the extra ring keeps chunks on the edge from reloading when
+ * the camera moves back and forth.
+ *
+ * Meshes are downsampled by distance (see LOD_DISTANCE), the sides facing a neighbour
+ * at another level of detail keep their faces so there are no holes along the seam.
+ * Moving the camera remeshes the chunks whose level or seams changed.
+ *
+ * Block edits mark chunks dirty in the World (see World::markDirty), every frame the
+ * dirty chunks join the remesh queue, at most REMESH_BATCH of them (nearest first) are
+ * remeshed. A chunk edited many times before its turn is remeshed once. Edited chunks
+ * drop the palette entries of removed blocks (see ChunkStorage::compact) when they're
+ * saved, compressed or unloaded.
+ *
+ * Every generated chunk is also added to the far field octree, which keeps them after
+ * they're unloaded from the World. Edited chunks are put in again when they're unloaded.
+ *
+ * With a RegionStore saved chunks are read asynchronously (see ChunkIO) instead of being
+ * generated, generated chunks are written back when they're unloaded or on save().
+ * A chunk whose write fails stays in the World (not unloaded nor compressed) and is
+ * written again on the next save() or camera move.
+ *
+ * Loaded chunks further than radius + 2 aren't needed for meshing, with compressFar they
+ * leave the World compressed (see ChunkCodec) until the camera comes back. They're
+ * missing for World lookups meanwhile, the far field still has them. Editing one puts it
+ * back into the World first (see World::setChunkSource), it's compressed again once the
+ * camera moves. So does editing a chunk within radius + 2 that isn't loaded yet: it's
+ * read or generated right away (its pending job is cancelled), an empty chunk in its
+ * place would lose the edit once the streamed one replaced it.
+ */
+class ChunkManager {
+    TerrainScheduler terrain_;
+    RegionStore* store_;
+    // reads the saved chunks, only with a store
+    std::unique_ptr<ChunkIO> io_;
+    // before meshes_, the meshing jobs write into it
+    StagingRing staging_;
+    MeshScheduler meshes_;
+    ChunkRenderer renderer_;
+    int radius_;
+    MeshingMode meshingMode_;
+
+    glm::ivec3 center_;
+    bool centered_;
+    // chunks inserted into the World by the manager
+    std::unordered_set<glm::ivec3> loaded_;
+    // loaded chunks that differ from the saved world
+    std::unordered_set<glm::ivec3> unsaved_;
+    // loaded chunks kept compressed out of the World
+    bool compressFar_;
+    std::unordered_map<glm::ivec3, std::vector<uint8_t>> compressed_;
+    size_t compressedBytes_;
+    struct Meshed {
+        std::unique_ptr<Chunk> chunk;
+        int lod;       // the last requested level of detail
+        uint8_t seams; // sides with a neighbour at another level of detail
+    };
+    // chunks with a mesh (or a mesh on the way)
+    std::unordered_map<glm::ivec3, Meshed> chunks_;
+    // chunks to generate sorted farthest first, the next one is at the back
+    std::vector<glm::ivec3> toLoad_;
+    std::vector<glm::ivec3> inserted_;
+    // chunks loaded for an edit (see claim), meshed on the next update
+    std::vector<glm::ivec3> claimed_;
+    std::vector<ChunkIO::Loaded> read_;
+    // meshed chunks waiting for a remesh after an edit
+    std::unordered_set<glm::ivec3> toRemesh_;
+    std::vector<glm::ivec3> modified_, dirty_, remeshing_;
+    // edited chunks the far field has an old copy of
+    std::unordered_set<glm::ivec3> farFieldStale_;
+    // per frame culling state, kept to reuse the memory
+    std::vector<const Chunk*> drawList_;
+    BoxList boxes_;
+    std::vector<uint8_t> visible_;
+    int visibleCount_, culledCount_;
+    // quads of meshes the arena may move per frame to close holes
+    static constexpr unsigned int COMPACT_BUDGET = 1 << 16;
+    // chunks requested from and inserted out of the saved world per frame, reading is cheaper
+    // than generating but inserting (far field, neighbour meshing) costs the same
+    static constexpr int READ_BATCH = 16;
+    // chunks remeshed after edits per frame, gathering the snapshot takes main thread time
+    static constexpr int REMESH_BATCH = 32;
+    // the far field covers 4096 blocks on each axis around the world origin
+    static constexpr int FAR_FIELD_LEVELS = 12;
+    SparseVoxelOctree farField_;
+
+public:
+    ChunkManager(const TerrainGenerator& generator, RegionStore* store = nullptr, int radius = Consts::VIEW_DISTANCE);
+    ~ChunkManager();
+
+    // loads, meshes and unloads chunks around the position, call every frame
+    void update(glm::vec3 cameraPos);
+    // draws the chunks inside the frustum (every chunk when it's null) with the bound shader
+    void draw(const Frustum* frustum = nullptr);
+    // remeshes every chunk and waits for the meshes to be uploaded
+    void remeshAll(MeshingMode mode);
+    // unloads every chunk (saving them first), has to be called while the gl context is alive
+    void clear();
+    // writes the unsaved chunks to the store, returns how many were written,
+    // the failed ones stay unsaved
+    int save();
+
+    int loadedCount() const { return loaded_.size(); }
+    int chunkCount() const { return chunks_.size(); }
+    int pendingCount() const { return terrain_.pending() + meshes_.pending() + readingCount(); }
+    int readingCount() const { return io_ ? io_->pending() : 0; }
+    // nullptr without a store
+    const ChunkIO* io() const { return io_.get(); }
+    int radius() const { return radius_; }
+    int unsavedCount() const { return unsaved_.size(); }
+    int remeshQueueSize() const { return toRemesh_.size(); }
+    // compresses the chunks beyond radius + 2 or puts them all back to the World
+    void setCompressFar(bool compress);
+    bool compressFar() const { return compressFar_; }
+    int compressedCount() const { return compressed_.size(); }
+    size_t compressedBytes() const { return compressedBytes_; }
+    // chunks with a mesh drawn and skipped by the last draw
+    int visibleCount() const { return visibleCount_; }
+    int culledCount() const { return culledCount_; }
+    int drawCalls() const { return renderer_.drawCalls(); }
+    MeshArena::Stats arenaStats() const { return renderer_.arena().stats(); }
+    const StagingRing& staging() const { return staging_; }
+    const SparseVoxelOctree& farField() const { return farField_; }
+
+private:
+    bool inRadius(glm::ivec3 chunkPos, int radius) const;
+    void recenter(glm::ivec3 center);
+    // moves the chunk out of the World into compressed_ (saving it first) and back
+    void compress(glm::ivec3 chunkPos);
+    void decompress(glm::ivec3 chunkPos);
+    // loads a chunk within the load radius right away instead of streaming it
+    ChunkStorage* claim(glm::ivec3 chunkPos);
+    void tryMesh(glm::ivec3 chunkPos);
+    // the chunk and its neighbours, one of them may have been the last missing one
+    void tryMeshAround(glm::ivec3 chunkPos);
+    int lodFor(glm::ivec3 chunkPos) const;
+    uint8_t seamsFor(glm::ivec3 chunkPos, int lod) const;
+    // remeshes the chunks whose level of detail or seams changed with the center
+    void updateLods();
+    // takes the edits from the World and remeshes the nearest dirty chunks
+    void remeshDirty();
+    void unload(glm::ivec3 chunkPos);
+};
@@ -0,0 +1,91 @@
+#include "ChunkRenderer.h"
+
+#include <GL/glew.h>
+
+#include "GLCommon.h"
+#include "QuadIndexBuffer.h"
+#include "tracy/Tracy.hpp"
+
+
+ChunkRenderer::ChunkRenderer() : drawCalls_(0) {
+    GLCall(glGenVertexArrays(1, &vao_));
+    GLCall(glGenBuffers(1, &commandBuffer_));
+    GLCall(glGenBuffers(1, &originBuffer_));
+
+    GLCall(glBindVertexArray(vao_));
+    // binding 0: a single packed int per vertex, see PackedVertex
+    GLCall(glEnableVertexAttribArray(0));
+    GLCall(glVertexAttribIFormat(0, 1, GL_UNSIGNED_INT, 0));
+    GLCall(glVertexAttribBinding(0, 0));
+    // binding 1: the chunk origin and level of detail, advancing once per draw
+    GLCall(glEnableVertexAttribArray(1));
+    GLCall(glVertexAttribIFormat(1, 4, GL_INT, 0));
+    GLCall(glVertexAttribBinding(1, 1));
+    GLCall(glVertexBindingDivisor(1, 1));
+    GLCall(glBindVertexBuffer(1, originBuffer_, 0, sizeof(glm::ivec4)));
+
+    QuadIndexBuffer::bind();
+    GLCall(glBindVertexArray(0));
+}
+
+ChunkRenderer::~ChunkRenderer() {
+    GLCall(glDeleteBuffers(1, &originBuffer_));
+    GLCall(glDeleteBuffers(1, &commandBuffer_));
+    GLCall(glDeleteVertexArrays(1, &vao_));
+}
+
+void ChunkRenderer::begin() {
+    for (auto& commands : pageCommands_) {
+        commands.clear();
+    }
+    origins_.clear();
+}
+
+void ChunkRenderer::add(const Chunk& chunk) {
+    if (chunk.mesh() == MeshArena::NONE) {
+        return;
+    }
+    const MeshArena::Allocation& mesh = arena_.get(chunk.mesh());
+    if (pageCommands_.size() <= mesh.page) {
+        pageCommands_.resize(mesh.page + 1);
+    }
+    pageCommands_[mesh.page].push_back({
+        mesh.size * QuadIndexBuffer::INDICES_PER_QUAD,
+        1,
+        0,
+        (int32_t)(mesh.offset * MeshArena::VERTICES_PER_QUAD),
+        (uint32_t)origins_.size(),
+    });
+    origins_.push_back(glm::ivec4(chunk.position(), chunk.lod()));
+}
+
+void ChunkRenderer::draw() {
+    ZoneScopedN("ChunkRenderer::draw");
+    drawCalls_ = 0;
+    if (origins_.empty()) {
+        return;
+    }
+    commands_.clear();
+    for (auto& commands : pageCommands_) {
+        commands_.insert(commands_.end(), commands.begin(), commands.end());
+    }
+    glBindVertexArray(vao_);
+
+    // orphaned every frame so the driver doesn't wait for the previous frame to finish
+    glBindBuffer(GL_ARRAY_BUFFER, originBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, origins_.size() * sizeof(glm::ivec4), origins_.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawCommand), commands_.data(), GL_STREAM_DRAW);
+
+    size_t first = 0;
+    for (size_t page = 0; page < pageCommands_.size(); page++) {
+        size_t count = pageCommands_[page].size();
+        if (count == 0) {
+            continue;
+        }
+        glBindVertexBuffer(0, arena_.buffer(page), 0, sizeof(uint32_t));
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawCommand)), count, 0);
+        first += count;
+        drawCalls_++;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Chunk.h"
+#include "MeshArena.h"
+
+/*
+ * Draws the chunk meshes with one glMultiDrawElementsIndirect per MeshArena page
+ *
+ * A draw command points at the mesh range with the base vertex and at its chunk origin
+ * with the base instance (the origins are an instanced attribute, so each draw reads
+ * its own). The fourth component of the origin is the level of detail of the mesh.
+ */
+class ChunkRenderer {
+    // layout defined by OpenGL
+    struct DrawCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    MeshArena arena_;
+    unsigned int vao_, commandBuffer_, originBuffer_;
+    std::vector<std::vector<DrawCommand>> pageCommands_;
+    std::vector<DrawCommand> commands_; // pageCommands_ one after another
+    std::vector<glm::ivec4> origins_;
+    int drawCalls_;
+
+public:
+    ChunkRenderer();
+    ~ChunkRenderer();
+    ChunkRenderer(const ChunkRenderer&) = delete;
+    ChunkRenderer& operator=(const ChunkRenderer&) = delete;
+
+    MeshArena& arena() { return arena_; }
+    const MeshArena& arena() const { return arena_; }
+
+    // collects the draws of a frame, empty chunks are skipped
+    void begin();
+    void add(const Chunk& chunk);
+    // draws everything added since begin, the shader has to be bound
+    void draw();
+    // chunks and multi draw calls of the last frame
+    int drawCount() const { return origins_.size(); }
+    int drawCalls() const { return drawCalls_; }
+};
@@ -0,0 +1,184 @@
+#include "ChunkSnapshot.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tracy/Tracy.hpp"
+#include "World.h"
+
+
+// the most common block of a cell, air unless at least half of the cell is solid
+static Block majority(const Block* cell, int count) {
+    // cells hold only a few different blocks, the rare ones past the limit are ignored
+    constexpr int MAX_DISTINCT = 16;
+    uint16_t ids[MAX_DISTINCT];
+    int counts[MAX_DISTINCT];
+    int distinct = 0, solid = 0;
+    for (int i = 0; i < count; i++) {
+        if (cell[i].id == Consts::BlockIDs::air) {
+            continue;
+        }
+        solid++;
+        int j = 0;
+        while (j < distinct && ids[j] != cell[i].id) {
+            j++;
+        }
+        if (j == distinct) {
+            if (distinct == MAX_DISTINCT) {
+                continue;
+            }
+            ids[distinct] = cell[i].id;
+            counts[distinct++] = 0;
+        }
+        counts[j]++;
+    }
+    if (solid * 2 < count) {
+        return {Consts::BlockIDs::air};
+    }
+    int best = 0;
+    for (int j = 1; j < distinct; j++) {
+        if (counts[j] > counts[best]) {
+            best = j;
+        }
+    }
+    return {ids[best]};
+}
+
+void ChunkSnapshot::gather(glm::ivec3 chunkPos, int lod, uint8_t seams) {
+    ZoneScopedN("ChunkSnapshot::gather");
+    this->lod = lod;
+    size = Consts::CHUNK_SIZE >> lod;
+    if (lod == 0) {
+        gatherFull(chunkPos);
+    } else {
+        gatherDownsampled(chunkPos);
+    }
+
+    // the whole padding layer of a seam side, with its edges and corners
+    for (int dir = 0; dir < 6; dir++) {
+        if (!(seams & (1 << dir))) {
+            continue;
+        }
+        const int axis = dir >> 1;
+        const int layer = (dir & 1) ? -1 : size;
+        glm::ivec3 p;
+        for (int v = -1; v <= size; v++) {
+            for (int u = -1; u <= size; u++) {
+                p[axis] = layer;
+                p[(axis + 1) % 3] = u;
+                p[(axis + 2) % 3] = v;
+                blocks[index(p.x, p.y, p.z)] = {Consts::BlockIDs::air};
+            }
+        }
+    }
+}
+
+void ChunkSnapshot::gatherFull(glm::ivec3 chunkPos) {
+    const int S = Consts::CHUNK_SIZE;
+    blocks.fill({Consts::BlockIDs::air});
+    uniform = true;
+
+    if (const ChunkStorage* center = World::getChunk(chunkPos)) {
+        uniform = center->isUniform();
+        static thread_local std::vector<Block> unpacked(Consts::CHUNK_SIZE_POW3);
+        center->unpack(unpacked.data());
+        for (int z = 0; z < S; z++) {
+            for (int y = 0; y < S; y++) {
+                const Block* row = &unpacked[ChunkStorage::index(0, y, z)];
+                std::copy(row, row + S, &blocks[index(0, y, z)]);
+            }
+        }
+    }
+
+    // only the voxels touching this chunk are copied from the 26 neighbours,
+    // a layer from the face neighbours, a row from the edge ones and a voxel from the corners
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0 && dz == 0) {
+                    continue;
+                }
+                const ChunkStorage* n = World::getChunk(chunkPos + glm::ivec3(dx, dy, dz));
+                if (!n) {
+                    continue;
+                }
+                // range of local coordinates covered by the neighbour along each axis
+                glm::ivec3 from(dx < 0 ? -1 : (dx == 0 ? 0 : S), dy < 0 ? -1 : (dy == 0 ? 0 : S), dz < 0 ? -1 : (dz == 0 ? 0 : S));
+                glm::ivec3 to(dx == 0 ? S : from.x + 1, dy == 0 ? S : from.y + 1, dz == 0 ? S : from.z + 1);
+                glm::ivec3 shift = glm::ivec3(dx, dy, dz) * S;
+                for (int z = from.z; z < to.z; z++)
+                    for (int y = from.y; y < to.y; y++)
+                        for (int x = from.x; x < to.x; x++)
+                            blocks[index(x, y, z)] = n->get(x - shift.x, y - shift.y, z - shift.z);
+            }
+        }
+    }
+}
+
+void ChunkSnapshot::gatherDownsampled(glm::ivec3 chunkPos) {
+    ZoneScopedN("ChunkSnapshot::gatherDownsampled");
+    const int S = size;
+    const int n = 1 << lod;
+    Block cell[1 << (3 * MAX_LOD)];
+    blocks.fill({Consts::BlockIDs::air});
+    uniform = true;
+
+    if (const ChunkStorage* center = World::getChunk(chunkPos)) {
+        uniform = center->isUniform();
+        if (uniform) {
+            const Block block = center->get(0);
+            for (int z = 0; z < S; z++)
+                for (int y = 0; y < S; y++)
+                    std::fill_n(&blocks[index(0, y, z)], S, block);
+        } else {
+            static thread_local std::vector<Block> unpacked(Consts::CHUNK_SIZE_POW3);
+            center->unpack(unpacked.data());
+            for (int z = 0; z < S; z++) {
+                for (int y = 0; y < S; y++) {
+                    for (int x = 0; x < S; x++) {
+                        Block* out = cell;
+                        for (int cz = 0; cz < n; cz++)
+                            for (int cy = 0; cy < n; cy++, out += n)
+                                std::copy_n(&unpacked[ChunkStorage::index(x*n, y*n + cy, z*n + cz)], n, out);
+                        blocks[index(x, y, z)] = majority(cell, n*n*n);
+                    }
+                }
+            }
+        }
+    }
+
+    // the padding holds the downsampled voxels of the neighbours touching this chunk
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0 && dz == 0) {
+                    continue;
+                }
+                const ChunkStorage* neighbour = World::getChunk(chunkPos + glm::ivec3(dx, dy, dz));
+                if (!neighbour) {
+                    continue;
+                }
+                glm::ivec3 from(dx < 0 ? -1 : (dx == 0 ? 0 : S), dy < 0 ? -1 : (dy == 0 ? 0 : S), dz < 0 ? -1 : (dz == 0 ? 0 : S));
+                glm::ivec3 to(dx == 0 ? S : from.x + 1, dy == 0 ? S : from.y + 1, dz == 0 ? S : from.z + 1);
+                glm::ivec3 shift = glm::ivec3(dx, dy, dz) * S;
+                for (int z = from.z; z < to.z; z++) {
+                    for (int y = from.y; y < to.y; y++) {
+                        for (int x = from.x; x < to.x; x++) {
+                            if (neighbour->isUniform()) {
+                                blocks[index(x, y, z)] = neighbour->get(0);
+                                continue;
+                            }
+                            glm::ivec3 v = (glm::ivec3(x, y, z) - shift) * n;
+                            Block* out = cell;
+                            for (int cz = 0; cz < n; cz++)
+                                for (int cy = 0; cy < n; cy++)
+                                    for (int cx = 0; cx < n; cx++)
+                                        *out++ = neighbour->get(v.x + cx, v.y + cy, v.z + cz);
+                            blocks[index(x, y, z)] = majority(cell, n*n*n);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
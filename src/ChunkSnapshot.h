@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Block.h"
+#include "WorldConstants.h"
+
+/*
+ * Immutable copy of a chunk padded by one voxel on each side
+ *
+ * The padding holds the touching voxels of the 26 neighbouring chunks, so the mesher
+ * can look at the neighbours of any voxel (including the diagonal ones for ambient
+ * occlusion) without leaving the array.
+ *
+ * A snapshot at a level of detail holds the chunk downsampled by 2^lod on each axis,
+ * every voxel is the majority vote of the blocks it covers. The voxels keep the same
+ * indices, only the first size + 2 of each axis are used.
+ */
+struct ChunkSnapshot {
+    static constexpr int SIZE = Consts::CHUNK_SIZE + 2;
+    static constexpr int SIZE_POW2 = SIZE*SIZE;
+    static constexpr int SIZE_POW3 = SIZE*SIZE*SIZE;
+
+    static constexpr int MAX_LOD = 3;
+
+    std::array<Block, SIZE_POW3> blocks;
+    bool uniform; // the chunk itself (not the padding) is made of a single block
+    int lod;
+    int size; // voxels of the chunk along each axis, CHUNK_SIZE >> lod
+
+    // coordinates are chunk-local, ranging from -1 to CHUNK_SIZE
+    static constexpr int index(int x, int y, int z) {
+        return (x+1) + (y+1)*SIZE + (z+1)*SIZE_POW2;
+    }
+    Block at(int x, int y, int z) const { return blocks[index(x, y, z)]; }
+
+    // copies the chunk at chunk coordinates and the touching voxels of its neighbours out of the World,
+    // the padding on the sides set in seams (bits in the Mesher direction order) is left empty,
+    // so the faces towards a neighbour meshed at another level of detail are always there
+    void gather(glm::ivec3 chunkPos, int lod = 0, uint8_t seams = 0);
+
+private:
+    void gatherFull(glm::ivec3 chunkPos);
+    void gatherDownsampled(glm::ivec3 chunkPos);
+};
@@ -0,0 +1,159 @@
+#include "ChunkStorage.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+ChunkStorage::ChunkStorage() : ChunkStorage({Consts::BlockIDs::air}) {}
+
+ChunkStorage::ChunkStorage(Block fill) {
+    this->fill(fill);
+}
+
+int ChunkStorage::bitsFor(size_t paletteSize) {
+    int bits = 0;
+    while ((1ull << bits) < paletteSize) {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    return bits;
+}
+
+void ChunkStorage::set(int idx, Block block) {
+    if (bits_ == 0 && palette_[0] == block) {
+        return;
+    }
+    int paletteIdx = findOrAdd(block);
+    writeIndex(idx, paletteIdx);
+    if (block.id != Consts::BlockIDs::air) {
+        markBrick(idx);
+    }
+}
+
+int ChunkStorage::findOrAdd(Block block) {
+    for (size_t i = 0; i < palette_.size(); i++) {
+        if (palette_[i] == block) {
+            return i;
+        }
+    }
+    palette_.push_back(block);
+    int bits = bitsFor(palette_.size());
+    if (bits > bits_) {
+        resize(bits);
+    }
+    return palette_.size() - 1;
+}
+
+void ChunkStorage::resize(int bits) {
+    assert(bits <= MAX_BITS && "chunk palette overflow");
+    std::vector<uint64_t> data(Consts::CHUNK_SIZE_POW3 * bits / 64, 0);
+    if (bits_ != 0) {
+        for (int i = 0; i < Consts::CHUNK_SIZE_POW3; i++) {
+            unsigned int bit = i * bits;
+            data[bit >> 6] |= (uint64_t)readIndex(i) << (bit & 63);
+        }
+    }
+    // in the single value mode every voxel points to palette_[0] which is all zeroes
+    data_.swap(data);
+    bits_ = bits;
+}
+
+void ChunkStorage::fill(Block block) {
+    palette_.assign(1, block);
+    data_.clear();
+    data_.shrink_to_fit();
+    bits_ = 0;
+    bricks_.fill(block.id != Consts::BlockIDs::air ? ~0ull : 0);
+}
+
+void ChunkStorage::assign(const Block* blocks) {
+    palette_.clear();
+    bricks_.fill(0);
+    // scratch indices, packed once the final palette size is known
+    static thread_local std::vector<uint16_t> indices(Consts::CHUNK_SIZE_POW3);
+    Block last = blocks[0];
+    unsigned int lastIdx = 0;
+    palette_.push_back(last);
+    for (int i = 0; i < Consts::CHUNK_SIZE_POW3; i++) {
+        if (!(blocks[i] == last)) {
+            last = blocks[i];
+            lastIdx = palette_.size();
+            for (size_t p = 0; p < palette_.size(); p++) {
+                if (palette_[p] == last) {
+                    lastIdx = p;
+                    break;
+                }
+            }
+            if (lastIdx == palette_.size()) {
+                assert(palette_.size() < (1u << MAX_BITS) && "chunk palette overflow");
+                palette_.push_back(last);
+            }
+        }
+        indices[i] = lastIdx;
+        if (last.id != Consts::BlockIDs::air) {
+            markBrick(i);
+        }
+    }
+
+    bits_ = bitsFor(palette_.size());
+    data_.assign(Consts::CHUNK_SIZE_POW3 * bits_ / 64, 0);
+    data_.shrink_to_fit();
+    if (bits_ == 0) {
+        return;
+    }
+    // whole words at once, the first index goes to the lowest bits
+    const int perWord = 64 / bits_;
+    const uint16_t* in = indices.data();
+    for (uint64_t& word : data_) {
+        uint64_t packed = 0;
+        for (int j = perWord - 1; j >= 0; j--) {
+            packed = (packed << bits_) | in[j];
+        }
+        word = packed;
+        in += perWord;
+    }
+}
+
+void ChunkStorage::updateBricks() {
+    bool anyAir = false, anySolid = false;
+    for (Block block : palette_) {
+        anyAir |= block.id == Consts::BlockIDs::air;
+        anySolid |= block.id != Consts::BlockIDs::air;
+    }
+    bricks_.fill(anySolid && !anyAir ? ~0ull : 0);
+    if (!anySolid || !anyAir) {
+        return;
+    }
+    for (int i = 0; i < Consts::CHUNK_SIZE_POW3; i++) {
+        if (palette_[readIndex(i)].id != Consts::BlockIDs::air) {
+            markBrick(i);
+        }
+    }
+}
+
+void ChunkStorage::unpack(Block* out) const {
+    if (bits_ == 0) {
+        std::fill(out, out + Consts::CHUNK_SIZE_POW3, palette_[0]);
+        return;
+    }
+    const unsigned int perWord = 64 / bits_;
+    const uint64_t mask = (1ull << bits_) - 1;
+    int i = 0;
+    for (uint64_t word : data_) {
+        for (unsigned int j = 0; j < perWord; j++, word >>= bits_) {
+            out[i++] = palette_[word & mask];
+        }
+    }
+}
+
+void ChunkStorage::compact() {
+    if (bits_ == 0) {
+        return;
+    }
+    static thread_local std::vector<Block> blocks(Consts::CHUNK_SIZE_POW3);
+    unpack(blocks.data());
+    assign(blocks.data());
+}
+
+size_t ChunkStorage::memoryUsage() const {
+    return palette_.capacity() * sizeof(Block) + data_.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Block.h"
+#include "WorldConstants.h"
+
+/*
+ * Palette compressed voxel storage of a single chunk, indexed by chunk-local coordinates
+ *
+ * Every distinct block of the chunk is stored once in the palette, voxels only hold
+ * bit-packed indices into it. The index width grows 1->2->4->8->16 bits as new blocks
+ * appear, a chunk made of a single block (air, solid stone) stores no indices at all.
+ *
+ * A bit per brick of BRICK^3 voxels tells whether it may hold anything but air, so
+ * readers like the Raycaster can step over empty regions without reading them.
+ */
+class ChunkStorage {
+    // reads and writes the packed indices directly
+    friend class ChunkCodec;
+
+public:
+    static_assert(std::has_single_bit((unsigned int)Consts::CHUNK_SIZE), "CHUNK_SIZE has to be a power of two");
+    static constexpr int SHIFT = std::countr_zero((unsigned int)Consts::CHUNK_SIZE);
+    static constexpr int MASK = Consts::CHUNK_LAST_IDX;
+    static constexpr int MAX_BITS = 16;
+    static constexpr int BRICK = 8;
+    static_assert(Consts::CHUNK_SIZE % BRICK == 0, "CHUNK_SIZE has to be a multiple of BRICK");
+    static constexpr int BRICKS = Consts::CHUNK_SIZE / BRICK; // per axis
+
+private:
+    std::vector<Block> palette_;
+    std::vector<uint64_t> data_;
+    int bits_; // bits per voxel index, 0 means the whole chunk is palette_[0]
+    // bricks holding a non-air block, x fastest like the voxels, set on writes and
+    // only cleared when the whole chunk is rebuilt (fill, assign, compact)
+    std::array<uint64_t, (BRICKS * BRICKS * BRICKS + 63) / 64> bricks_;
+
+public:
+    ChunkStorage();
+    ChunkStorage(Block fill);
+
+    // x is the fastest varying axis, then y, then z
+    static constexpr int index(int x, int y, int z) {
+        return x + (y << SHIFT) + (z << (2*SHIFT));
+    }
+
+    Block get(int x, int y, int z) const { return get(index(x, y, z)); }
+    Block get(int idx) const {
+        if (bits_ == 0) {
+            return palette_[0];
+        }
+        return palette_[readIndex(idx)];
+    }
+    void set(int x, int y, int z, Block block) { set(index(x, y, z), block); }
+    void set(int idx, Block block);
+
+    // sets every voxel to the block, switches to the single value mode
+    void fill(Block block);
+    // replaces the whole chunk with CHUNK_SIZE_POW3 blocks in index order
+    void assign(const Block* blocks);
+    // writes all CHUNK_SIZE_POW3 blocks in index order to out
+    void unpack(Block* out) const;
+    // drops palette entries no longer referenced by any voxel and shrinks the index width
+    void compact();
+
+    // false when the brick holding the voxel may have a non-air block
+    bool isBrickEmpty(int x, int y, int z) const {
+        int brick = brickIndex(x, y, z);
+        return !(bricks_[brick >> 6] & (1ull << (brick & 63)));
+    }
+
+    bool isUniform() const { return bits_ == 0; }
+    int bits() const { return bits_; }
+    const std::vector<Block>& palette() const { return palette_; }
+    // heap memory taken by the palette and indices in bytes
+    size_t memoryUsage() const;
+
+private:
+    static constexpr int brickIndex(int x, int y, int z) {
+        return x / BRICK + y / BRICK * BRICKS + z / BRICK * BRICKS * BRICKS;
+    }
+    void markBrick(int idx) {
+        int brick = brickIndex(idx & MASK, (idx >> SHIFT) & MASK, idx >> (2*SHIFT));
+        bricks_[brick >> 6] |= 1ull << (brick & 63);
+    }
+    // recomputes bricks_ from the voxels
+    void updateBricks();
+    unsigned int readIndex(int idx) const {
+        unsigned int bit = idx * bits_;
+        return (data_[bit >> 6] >> (bit & 63)) & ((1u << bits_) - 1);
+    }
+    void writeIndex(int idx, unsigned int value) {
+        unsigned int bit = idx * bits_;
+        uint64_t mask = (uint64_t)((1u << bits_) - 1) << (bit & 63);
+        data_[bit >> 6] = (data_[bit >> 6] & ~mask) | ((uint64_t)value << (bit & 63));
+    }
+    int findOrAdd(Block block);
+    // repacks indices to the given width (has to be big enough for the palette)
+    void resize(int bits);
+    static int bitsFor(size_t paletteSize);
+};
@@ -0,0 +1,109 @@
+#include "Frustum.h"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+#include "tracy/Tracy.hpp"
+
+
+void BoxList::clear() {
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+}
+
+void BoxList::add(glm::vec3 min, glm::vec3 max) {
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+    centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+    extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+}
+
+Frustum::Frustum() {
+    for (glm::vec4& plane : planes_) {
+        plane = {0.0f, 0.0f, 0.0f, 1.0f};
+    }
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    update(viewProjection);
+}
+
+void Frustum::update(const glm::mat4& viewProjection) {
+    // rows of the matrix, glm is column major
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = {viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+    }
+    planes_[0] = rows[3] + rows[0]; // left
+    planes_[1] = rows[3] - rows[0]; // right
+    planes_[2] = rows[3] + rows[1]; // bottom
+    planes_[3] = rows[3] - rows[1]; // top
+    planes_[4] = rows[3] + rows[2]; // near
+    planes_[5] = rows[3] - rows[2]; // far
+    for (glm::vec4& plane : planes_) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::isVisible(glm::vec3 min, glm::vec3 max) const {
+    return isBoxVisible((min + max) * 0.5f, (max - min) * 0.5f);
+}
+
+bool Frustum::isBoxVisible(glm::vec3 center, glm::vec3 extent) const {
+    for (const glm::vec4& plane : planes_) {
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        // how far the box reaches towards the plane
+        float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+        if (distance < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int Frustum::cull(const BoxList& boxes, std::vector<uint8_t>& visible) const {
+    ZoneScopedN("Frustum::cull");
+    int count = boxes.size();
+    visible.resize(count);
+    int visibleCount = 0;
+    int i = 0;
+#ifdef FRUSTUM_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : planes_) {
+            __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)), _mm_set1_ps(plane.w));
+            __m128 radius = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+                _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+                _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+            // distance < -radius
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_xor_ps(radius, signMask)));
+        }
+        int outsideBits = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++) {
+            visible[i + lane] = !(outsideBits & (1 << lane));
+        }
+        visibleCount += 4 - std::popcount((unsigned int)outsideBits);
+    }
+#endif
+    for (; i < count; i++) {
+        glm::vec3 center = {boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]};
+        glm::vec3 extent = {boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]};
+        visible[i] = isBoxVisible(center, extent);
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// axis aligned boxes as centers and half extents, one array per component so they can be tested in batches
+struct BoxList {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    void clear();
+    void add(glm::vec3 min, glm::vec3 max);
+    int size() const { return centerX.size(); }
+};
+
+/*
+ * The six planes of the camera view volume, extracted from the view projection matrix
+ *
+ * Plane normals point inside, a box is culled when it's fully behind any of the planes.
+ * Batched tests go 4 boxes at a time with SSE (part of every x86-64 cpu).
+ */
+class Frustum {
+    glm::vec4 planes_[6]; // xyz normal, w distance
+
+public:
+    Frustum();
+    Frustum(const glm::mat4& viewProjection);
+
+    void update(const glm::mat4& viewProjection);
+    bool isVisible(glm::vec3 min, glm::vec3 max) const;
+    // writes 1 for every visible box and 0 for the culled ones, returns the visible count
+    int cull(const BoxList& boxes, std::vector<uint8_t>& visible) const;
+
+private:
+    bool isBoxVisible(glm::vec3 center, glm::vec3 extent) const;
+};
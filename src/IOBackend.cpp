@@ -0,0 +1,244 @@
+#include "IOBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define IO_URING 1
+#endif
+
+#include "ThreadPool.h"
+#include "tracy/Tracy.hpp"
+
+
+class ThreadPoolBackend : public IOBackend {
+    static constexpr unsigned int THREADS = 2;
+
+    ThreadPool pool_;
+    std::mutex mutex_;
+    std::condition_variable doneCond_;
+    std::vector<Read*> done_;
+    int inFlight_;
+
+public:
+    ThreadPoolBackend() : pool_(THREADS), inFlight_(0) {}
+    ~ThreadPoolBackend() override { pool_.wait(); }
+
+    void submit(Read* read) override {
+        inFlight_++;
+        pool_.submit([this, read] {
+            ssize_t n = pread(read->fd, read->buffer, read->size, read->offset);
+            read->result = n < 0 ? -errno : (int)n;
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.push_back(read);
+            doneCond_.notify_one();
+        });
+    }
+
+    void poll(std::vector<Read*>& done, bool wait) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wait && inFlight_ > 0) {
+            doneCond_.wait(lock, [this] { return !done_.empty(); });
+        }
+        inFlight_ -= done_.size();
+        done.insert(done.end(), done_.begin(), done_.end());
+        done_.clear();
+    }
+
+    Kind kind() const override { return Kind::threadPool; }
+};
+
+#ifdef IO_URING
+/*
+ * io_uring through the raw system calls, the rings are shared with the kernel
+ *
+ * The main thread is the only one touching the rings: it fills submission entries
+ * in submit, poll hands them all to the kernel with one io_uring_enter and reaps the
+ * completion ring.
+ */
+class UringBackend : public IOBackend {
+    static constexpr unsigned int ENTRIES = 64;
+
+    int ring_;
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned int *sqHead_, *sqTail_, *sqArray_, sqMask_, sqEntries_;
+    unsigned int *cqHead_, *cqTail_, cqMask_;
+    io_uring_cqe* cqes_;
+    unsigned int unsubmitted_; // filled entries the kernel hasn't seen yet
+    int inFlight_;
+    // reads that didn't fit the submission ring
+    std::vector<Read*> waiting_;
+
+public:
+    UringBackend() : ring_(-1), sqRing_(MAP_FAILED), cqRing_(MAP_FAILED), sqes_((io_uring_sqe*)MAP_FAILED),
+        unsubmitted_(0), inFlight_(0) {}
+
+    ~UringBackend() override {
+        // the kernel writes into the buffers until the reads complete
+        std::vector<Read*> done;
+        while (inFlight_ > 0) {
+            poll(done, true);
+        }
+        if (sqes_ != MAP_FAILED) {
+            munmap(sqes_, sqesSize_);
+        }
+        if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingSize_);
+        }
+        if (sqRing_ != MAP_FAILED) {
+            munmap(sqRing_, sqRingSize_);
+        }
+        if (ring_ >= 0) {
+            close(ring_);
+        }
+    }
+
+    bool init() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_ = syscall(__NR_io_uring_setup, ENTRIES, &params);
+        if (ring_ < 0) {
+            return false;
+        }
+        // plain reads need 5.6, the same release added the feature flag below
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            return false;
+        }
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+        sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+        if (sqRing_ == MAP_FAILED) {
+            return false;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cqRing_ = sqRing_;
+        } else {
+            cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+            if (cqRing_ == MAP_FAILED) {
+                return false;
+            }
+        }
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe*)mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) {
+            return false;
+        }
+
+        uint8_t* sq = (uint8_t*)sqRing_;
+        sqHead_ = (unsigned int*)(sq + params.sq_off.head);
+        sqTail_ = (unsigned int*)(sq + params.sq_off.tail);
+        sqArray_ = (unsigned int*)(sq + params.sq_off.array);
+        sqMask_ = *(unsigned int*)(sq + params.sq_off.ring_mask);
+        sqEntries_ = params.sq_entries;
+        uint8_t* cq = (uint8_t*)cqRing_;
+        cqHead_ = (unsigned int*)(cq + params.cq_off.head);
+        cqTail_ = (unsigned int*)(cq + params.cq_off.tail);
+        cqMask_ = *(unsigned int*)(cq + params.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void submit(Read* read) override {
+        unsigned int tail = *sqTail_;
+        unsigned int head = std::atomic_ref<unsigned int>(*sqHead_).load(std::memory_order_acquire);
+        // the completion ring is twice as big, so it can't overflow while this one has room
+        if (tail - head == sqEntries_ || inFlight_ >= (int)sqEntries_) {
+            waiting_.push_back(read);
+            return;
+        }
+        unsigned int index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = read->fd;
+        sqe.off = read->offset;
+        sqe.addr = (uint64_t)(uintptr_t)read->buffer;
+        sqe.len = read->size;
+        sqe.user_data = (uint64_t)(uintptr_t)read;
+        sqArray_[index] = index;
+        std::atomic_ref<unsigned int>(*sqTail_).store(tail + 1, std::memory_order_release);
+        unsubmitted_++;
+        inFlight_++;
+    }
+
+    void poll(std::vector<Read*>& done, bool wait) override {
+        ZoneScopedN("UringBackend::poll");
+        bool block = wait && inFlight_ > 0;
+        if (unsubmitted_ > 0 || block) {
+            int submitted = syscall(__NR_io_uring_enter, ring_, unsubmitted_, block ? 1 : 0,
+                block ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            // on errors (EAGAIN, EINTR) the entries stay in the ring for the next poll
+            if (submitted > 0) {
+                unsubmitted_ -= submitted;
+            }
+        }
+
+        unsigned int head = *cqHead_;
+        unsigned int tail = std::atomic_ref<unsigned int>(*cqTail_).load(std::memory_order_acquire);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            Read* read = (Read*)(uintptr_t)cqe.user_data;
+            read->result = cqe.res;
+            done.push_back(read);
+            inFlight_--;
+        }
+        std::atomic_ref<unsigned int>(*cqHead_).store(head, std::memory_order_release);
+
+        // room for the reads that waited
+        std::vector<Read*> waiting;
+        waiting.swap(waiting_);
+        for (Read* read : waiting) {
+            submit(read);
+        }
+    }
+
+    Kind kind() const override { return Kind::uring; }
+};
+#endif
+
+std::unique_ptr<IOBackend> IOBackend::create() {
+    std::unique_ptr<IOBackend> backend = create(Kind::uring);
+    return backend ? std::move(backend) : create(Kind::threadPool);
+}
+
+std::unique_ptr<IOBackend> IOBackend::create(Kind kind) {
+    switch (kind) {
+    case Kind::threadPool:
+        return std::make_unique<ThreadPoolBackend>();
+    case Kind::uring: {
+#ifdef IO_URING
+        auto backend = std::make_unique<UringBackend>();
+        // containers often forbid io_uring
+        if (backend->init()) {
+            return backend;
+        }
+#endif
+        return nullptr;
+    }
+    }
+    return nullptr;
+}
+
+const char* IOBackend::kindName(Kind kind) {
+    switch (kind) {
+    case Kind::threadPool: return "thread pool";
+    case Kind::uring: return "io_uring";
+    }
+    return "unknown";
+}
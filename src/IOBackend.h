@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * Asynchronous reads of file ranges
+ *
+ * Reads are started on the main thread and picked up there once they're done, the
+ * backend decides where the actual reading happens: io_uring hands them to the kernel
+ * (Linux 5.6+), the thread pool one runs blocking preads on a couple of its own threads
+ * so a slow disk never stalls the shared workers.
+ */
+class IOBackend {
+public:
+    enum class Kind { threadPool, uring };
+
+    struct Read {
+        int fd;
+        uint64_t offset;
+        uint32_t size;
+        uint8_t* buffer; // has to stay alive until the read is done
+        void* user;
+        int result;      // bytes read or -errno, set once it's done
+    };
+
+    virtual ~IOBackend() = default;
+
+    // starts the read, it's handed to the system at the latest by the next poll
+    virtual void submit(Read* read) = 0;
+    // appends the finished reads to done, with wait blocks until there's at least one (if any is in flight)
+    virtual void poll(std::vector<Read*>& done, bool wait) = 0;
+    virtual Kind kind() const = 0;
+
+    // the best backend the system supports
+    static std::unique_ptr<IOBackend> create();
+    // returns nullptr if the system doesn't support the backend
+    static std::unique_ptr<IOBackend> create(Kind kind);
+    static const char* kindName(Kind kind);
+};
@@ -0,0 +1,272 @@
+#include "MeshArena.h"
+
+#include <bit>
+#include <GL/glew.h>
+
+#include "GLCommon.h"
+#include "QuadIndexBuffer.h"
+#include "tracy/Tracy.hpp"
+
+
+static_assert(QuadIndexBuffer::MAX_QUADS <= MeshArena::PAGE_QUADS, "every mesh has to fit in a page");
+
+MeshArena::MeshArena() : reserved_(0), used_(0), moved_(0) {
+    addPage();
+}
+
+MeshArena::~MeshArena() {
+    for (Page& page : pages_) {
+        if (page.buffer) {
+            GLCall(glDeleteBuffers(1, &page.buffer));
+        }
+    }
+}
+
+uint32_t MeshArena::sizeClass(uint32_t quads) {
+    if (quads <= MIN_CLASS) {
+        return MIN_CLASS;
+    }
+    // four classes per power of two wastes at most a quarter
+    uint32_t step = std::bit_floor(quads) / 4;
+    return (quads + step - 1) / step * step;
+}
+
+int MeshArena::binOf(uint32_t size) {
+    return std::bit_width(size) - 1;
+}
+
+MeshArena::Handle MeshArena::upload(Handle handle, const uint32_t* vertices, uint32_t quads) {
+    handle = place(handle, quads);
+    if (handle != NONE) {
+        const Allocation& allocation = allocations_[handle];
+        glBindBuffer(GL_ARRAY_BUFFER, pages_[allocation.page].buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)allocation.offset * BYTES_PER_QUAD,
+            (GLsizeiptr)allocation.size * BYTES_PER_QUAD, vertices);
+    }
+    return handle;
+}
+
+MeshArena::Handle MeshArena::copy(Handle handle, unsigned int buffer, size_t offset, uint32_t quads) {
+    handle = place(handle, quads);
+    if (handle != NONE) {
+        const Allocation& allocation = allocations_[handle];
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pages_[allocation.page].buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)offset, (GLintptr)allocation.offset * BYTES_PER_QUAD, (GLsizeiptr)allocation.size * BYTES_PER_QUAD);
+    }
+    return handle;
+}
+
+MeshArena::Handle MeshArena::place(Handle handle, uint32_t quads) {
+    if (quads == 0) {
+        free(handle);
+        return NONE;
+    }
+    uint32_t capacity = sizeClass(quads);
+    if (handle != NONE) {
+        Allocation& allocation = allocations_[handle];
+        // the same class is reused in place, the memory and the handle stay
+        if (allocation.capacity == capacity) {
+            used_ += quads;
+            used_ -= allocation.size;
+            allocation.size = quads;
+            return handle;
+        }
+        free(handle);
+    }
+
+    Allocation allocation = {0, 0, quads, capacity};
+    if (!allocate(capacity, allocation.page, allocation.offset)) {
+        addPage();
+        allocate(capacity, allocation.page, allocation.offset);
+    }
+    if (freeHandles_.empty()) {
+        handle = allocations_.size();
+        allocations_.push_back(allocation);
+    } else {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+        allocations_[handle] = allocation;
+    }
+    pages_[allocation.page].live[allocation.offset] = handle;
+    reserved_ += capacity;
+    used_ += quads;
+    return handle;
+}
+
+void MeshArena::free(Handle handle) {
+    if (handle == NONE) {
+        return;
+    }
+    Allocation& allocation = allocations_[handle];
+    pages_[allocation.page].live.erase(allocation.offset);
+    addFree(allocation.page, allocation.offset, allocation.capacity);
+    reserved_ -= allocation.capacity;
+    used_ -= allocation.size;
+    freeHandles_.push_back(handle);
+}
+
+bool MeshArena::allocate(uint32_t capacity, uint32_t& page, uint32_t& offset) {
+    // the first bin can hold ranges smaller than the capacity, the bigger ones always fit
+    int bin = binOf(capacity);
+    for (const RangeKey& key : bins_[bin]) {
+        auto range = pages_[key.first].free.find(key.second);
+        if (range->second >= capacity) {
+            page = key.first;
+            offset = key.second;
+            take(page, range, capacity);
+            return true;
+        }
+    }
+    for (bin++; bin < BIN_COUNT; bin++) {
+        if (!bins_[bin].empty()) {
+            RangeKey key = *bins_[bin].begin();
+            page = key.first;
+            offset = key.second;
+            take(page, pages_[page].free.find(offset), capacity);
+            return true;
+        }
+    }
+    return false;
+}
+
+void MeshArena::take(uint32_t page, std::map<uint32_t, uint32_t>::iterator range, uint32_t capacity) {
+    uint32_t offset = range->first;
+    uint32_t size = range->second;
+    removeFree(page, range);
+    if (size > capacity) {
+        // the rest can't touch another free range, so nothing to merge
+        pages_[page].free[offset + capacity] = size - capacity;
+        bins_[binOf(size - capacity)].insert({page, offset + capacity});
+    }
+}
+
+void MeshArena::addFree(uint32_t page, uint32_t offset, uint32_t size) {
+    auto& free = pages_[page].free;
+    auto next = free.lower_bound(offset);
+    if (next != free.end() && offset + size == next->first) {
+        size += next->second;
+        removeFree(page, next);
+    }
+    next = free.lower_bound(offset);
+    if (next != free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            removeFree(page, prev);
+        }
+    }
+    free[offset] = size;
+    bins_[binOf(size)].insert({page, offset});
+}
+
+void MeshArena::removeFree(uint32_t page, std::map<uint32_t, uint32_t>::iterator range) {
+    bins_[binOf(range->second)].erase({page, range->first});
+    pages_[page].free.erase(range);
+}
+
+uint32_t MeshArena::addPage() {
+    ZoneScopedN("MeshArena::addPage");
+    uint32_t page = 0;
+    while (page < pages_.size() && pages_[page].buffer != 0) {
+        page++;
+    }
+    if (page == pages_.size()) {
+        pages_.emplace_back();
+    }
+    GLCall(glGenBuffers(1, &pages_[page].buffer));
+    GLCall(glBindBuffer(GL_ARRAY_BUFFER, pages_[page].buffer));
+    GLCall(glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)PAGE_QUADS * BYTES_PER_QUAD, nullptr, GL_DYNAMIC_DRAW));
+    addFree(page, 0, PAGE_QUADS);
+    return page;
+}
+
+void MeshArena::releasePage(uint32_t page) {
+    ZoneScopedN("MeshArena::releasePage");
+    removeFree(page, pages_[page].free.begin());
+    GLCall(glDeleteBuffers(1, &pages_[page].buffer));
+    pages_[page].buffer = 0;
+}
+
+void MeshArena::compact(unsigned int maxQuads) {
+    ZoneScopedN("MeshArena::compact");
+    unsigned int moved = 0;
+    while (moved < maxQuads) {
+        // the last allocation of the last page in use
+        int last = pages_.size() - 1;
+        while (last >= 0 && pages_[last].live.empty()) {
+            last--;
+        }
+        if (last < 0) {
+            break;
+        }
+        Handle handle = std::prev(pages_[last].live.end())->second;
+        Allocation& allocation = allocations_[handle];
+
+        // the first hole before it that fits, in address order
+        int targetPage = -1;
+        std::map<uint32_t, uint32_t>::iterator target;
+        for (int page = 0; page <= last && targetPage < 0; page++) {
+            for (auto range = pages_[page].free.begin(); range != pages_[page].free.end(); range++) {
+                if (page == last && range->first > allocation.offset) {
+                    break;
+                }
+                if (range->second >= allocation.capacity) {
+                    targetPage = page;
+                    target = range;
+                    break;
+                }
+            }
+        }
+        if (targetPage < 0) {
+            break;
+        }
+
+        uint32_t offset = target->first;
+        take(targetPage, target, allocation.capacity);
+        glBindBuffer(GL_COPY_READ_BUFFER, pages_[allocation.page].buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pages_[targetPage].buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)allocation.offset * BYTES_PER_QUAD, (GLintptr)offset * BYTES_PER_QUAD,
+            (GLsizeiptr)allocation.size * BYTES_PER_QUAD);
+
+        pages_[allocation.page].live.erase(allocation.offset);
+        addFree(allocation.page, allocation.offset, allocation.capacity);
+        allocation.page = targetPage;
+        allocation.offset = offset;
+        pages_[targetPage].live[offset] = handle;
+        moved += allocation.capacity;
+    }
+    moved_ += moved;
+
+    // the first page always stays
+    for (uint32_t page = 1; page < pages_.size(); page++) {
+        if (pages_[page].buffer && pages_[page].live.empty()) {
+            releasePage(page);
+        }
+    }
+}
+
+MeshArena::Stats MeshArena::stats() const {
+    Stats stats = {};
+    size_t freeQuads = 0;
+    for (const Page& page : pages_) {
+        if (!page.buffer) {
+            continue;
+        }
+        stats.pages++;
+        stats.capacity += PAGE_QUADS;
+        for (auto& [offset, size] : page.free) {
+            stats.freeRanges++;
+            stats.largestFree = std::max<size_t>(stats.largestFree, size);
+            freeQuads += size;
+        }
+    }
+    stats.reserved = reserved_;
+    stats.used = used_;
+    stats.fragmentation = freeQuads ? 1.0f - (float)stats.largestFree / freeQuads : 0.0f;
+    stats.moved = moved_;
+    return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*
+ * Sub-allocator for chunk meshes over a few large vertex buffers (pages)
+ *
+ * Sizes are measured in quads (4 packed vertices) and rounded up to size classes, four
+ * per power of two, so a remeshed chunk usually fits back into its old range. Free ranges
+ * are binned by size and taken first-fit in address order, empty neighbours are merged.
+ * compact() moves the meshes at the end into holes nearer the start a few at a time
+ * (copied on the gpu), so pages left empty can be released.
+ *
+ * Meshes are referenced by handles because compaction moves them.
+ */
+class MeshArena {
+public:
+    static constexpr unsigned int VERTICES_PER_QUAD = 4;
+    static constexpr unsigned int BYTES_PER_QUAD = VERTICES_PER_QUAD * sizeof(uint32_t);
+    static constexpr unsigned int PAGE_QUADS = 1 << 20; // 16 MiB buffers
+    static constexpr unsigned int MIN_CLASS = 8;
+
+    using Handle = uint32_t;
+    static constexpr Handle NONE = UINT32_MAX;
+
+    struct Allocation {
+        uint32_t page;
+        uint32_t offset;   // in quads from the start of the page
+        uint32_t size;     // quads of the mesh
+        uint32_t capacity; // quads reserved, size rounded up to the size class
+    };
+
+    struct Stats {
+        int pages;
+        size_t capacity;  // quads of all pages
+        size_t reserved;  // quads taken by allocations including rounding
+        size_t used;      // quads of the meshes
+        size_t freeRanges;
+        size_t largestFree;
+        float fragmentation; // 1 - largest free range / all free quads
+        size_t moved;        // quads moved by compaction so far
+    };
+
+private:
+    static constexpr int BIN_COUNT = 32;
+    using RangeKey = std::pair<uint32_t, uint32_t>; // page, offset
+
+    struct Page {
+        unsigned int buffer; // 0 once released
+        std::map<uint32_t, uint32_t> free; // offset -> size
+        std::map<uint32_t, Handle> live;   // offset -> allocation
+    };
+
+    std::vector<Page> pages_;
+    // free ranges of each size bin (log2 of the size) in address order
+    std::array<std::set<RangeKey>, BIN_COUNT> bins_;
+    std::vector<Allocation> allocations_;
+    std::vector<Handle> freeHandles_;
+    size_t reserved_, used_, moved_;
+
+public:
+    MeshArena();
+    ~MeshArena();
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    // replaces the mesh behind the handle (or makes a new one for NONE) and returns its handle,
+    // empty meshes release the memory and return NONE
+    Handle upload(Handle handle, const uint32_t* vertices, uint32_t quads);
+    // same as upload, the vertices are copied on the gpu from offset (in bytes) of another buffer
+    Handle copy(Handle handle, unsigned int buffer, size_t offset, uint32_t quads);
+    void free(Handle handle);
+    const Allocation& get(Handle handle) const { return allocations_[handle]; }
+
+    int pageCount() const { return pages_.size(); }
+    // 0 for released pages
+    unsigned int buffer(int page) const { return pages_[page].buffer; }
+
+    // moves up to maxQuads quads of meshes from the end into earlier holes and releases empty pages
+    void compact(unsigned int maxQuads);
+    Stats stats() const;
+
+    static uint32_t sizeClass(uint32_t quads);
+
+private:
+    bool allocate(uint32_t capacity, uint32_t& page, uint32_t& offset);
+    // takes capacity quads from the start of the free range
+    void take(uint32_t page, std::map<uint32_t, uint32_t>::iterator range, uint32_t capacity);
+    void addFree(uint32_t page, uint32_t offset, uint32_t size);
+    void removeFree(uint32_t page, std::map<uint32_t, uint32_t>::iterator range);
+    uint32_t addPage();
+    void releasePage(uint32_t page);
+    // makes the handle hold quads, in place when it's the same size class
+    Handle place(Handle handle, uint32_t quads);
+    static int binOf(uint32_t size);
+};
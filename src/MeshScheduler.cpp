@@ -0,0 +1,127 @@
+#include "MeshScheduler.h"
+
+#include <cstring>
+
+#include "tracy/Tracy.hpp"
+
+
+MeshScheduler::MeshScheduler(StagingRing* staging, ThreadPool& pool)
+    : staging_(staging), pool_(pool), nextVersion_(0), running_(0)
+{
+}
+
+MeshScheduler::~MeshScheduler() {
+    // the workers still write into the jobs
+    pending_.clear();
+    while (running_ > 0) {
+        collect(true);
+    }
+    // nothing is uploaded anymore, the staged meshes give their regions back to the ring
+    for (Job* job : collected_) {
+        if (job->staged) {
+            staging_->drop(job->region);
+        }
+        recycle(job);
+    }
+    collected_.clear();
+    if (staging_) {
+        staging_->reclaim();
+    }
+}
+
+void MeshScheduler::schedule(Chunk* chunk, glm::ivec3 chunkPos, MeshingMode mode, int lod, uint8_t seams) {
+    ZoneScopedN("MeshScheduler::schedule");
+    Job* job;
+    if (free_.empty()) {
+        jobs_.push_back(std::make_unique<Job>());
+        job = jobs_.back().get();
+    } else {
+        job = free_.back();
+        free_.pop_back();
+    }
+    job->chunkPos = chunkPos;
+    job->version = ++nextVersion_;
+    job->mode = mode;
+    job->snapshot.gather(chunkPos, lod, seams);
+    pending_[chunkPos] = {chunk, job->version};
+    running_++;
+
+    pool_.submit([this, job] {
+        ZoneScopedN("MeshScheduler::mesh");
+        job->mesh.clear();
+        Mesher mesher(job->mesh);
+        mesher.build(job->snapshot, job->mode);
+        uint32_t size = job->mesh.vertices.size() * sizeof(uint32_t);
+        job->staged = staging_ && size > 0 && staging_->reserve(size, job->region);
+        if (job->staged) {
+            std::memcpy(job->region.data, job->mesh.vertices.data(), size);
+        }
+        // notified under the lock, the scheduler may be destroyed as soon as it's released
+        std::lock_guard<std::mutex> lock(completedMutex_);
+        completed_.push_back(job);
+        completedCond_.notify_one();
+    });
+}
+
+void MeshScheduler::forget(glm::ivec3 chunkPos) {
+    pending_.erase(chunkPos);
+}
+
+int MeshScheduler::upload(int maxUploads) {
+    ZoneScopedN("MeshScheduler::upload");
+    if (staging_) {
+        staging_->reclaim();
+    }
+    collect(false);
+    int uploaded = 0;
+    size_t i = 0;
+    for (; i < collected_.size() && uploaded < maxUploads; i++) {
+        Job* job = collected_[i];
+        auto it = pending_.find(job->chunkPos);
+        // stale results (remeshed again or forgotten since) are dropped
+        bool current = it != pending_.end() && it->second.version == job->version;
+        if (current && job->staged) {
+            it->second.chunk->uploadMesh(staging_->buffer(), job->region.offset, job->mesh.quadCount(), job->mesh.lod);
+            staging_->submit(job->region);
+        } else if (current) {
+            it->second.chunk->uploadMesh(job->mesh);
+        } else if (job->staged) {
+            staging_->drop(job->region);
+        }
+        if (current) {
+            pending_.erase(it);
+            uploaded++;
+        }
+        recycle(job);
+    }
+    // the rest waits for the next call
+    collected_.erase(collected_.begin(), collected_.begin() + i);
+    if (staging_) {
+        staging_->fence();
+    }
+    return uploaded;
+}
+
+void MeshScheduler::finish() {
+    ZoneScopedN("MeshScheduler::finish");
+    upload();
+    // uploads whatever is done while the rest is still meshing
+    while (running_ > 0) {
+        collect(true);
+        upload();
+    }
+}
+
+void MeshScheduler::collect(bool block) {
+    std::unique_lock<std::mutex> lock(completedMutex_);
+    if (block) {
+        completedCond_.wait(lock, [this] { return !completed_.empty(); });
+    }
+    running_ -= completed_.size();
+    collected_.insert(collected_.end(), completed_.begin(), completed_.end());
+    completed_.clear();
+}
+
+void MeshScheduler::recycle(Job* job) {
+    free_.push_back(job);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "Chunk.h"
+#include "ChunkSnapshot.h"
+#include "Mesher.h"
+#include "StagingRing.h"
+#include "ThreadPool.h"
+
+/*
+ * Meshes chunks on the thread pool
+ *
+ * The snapshot is gathered on the main thread (the World isn't thread safe), the mesher
+ * runs on a worker and the finished mesh waits in a queue until the main thread uploads it.
+ * Jobs are keyed by chunk coordinates, remeshing a chunk again before its previous job
+ * finished bumps the version and the outdated result is thrown away.
+ *
+ * With a staging ring the worker also writes the vertices into its mapped memory, so the
+ * main thread only issues the gpu copy. When the ring is full the mesh is uploaded from the job.
+ */
+class MeshScheduler {
+    struct Job {
+        glm::ivec3 chunkPos;
+        uint64_t version;
+        MeshingMode mode;
+        ChunkSnapshot snapshot;
+        MeshData mesh;
+        bool staged; // the vertices are in region
+        StagingRing::Region region;
+    };
+    struct Pending {
+        Chunk* chunk;
+        uint64_t version; // the only version of the mesh that gets uploaded
+    };
+
+    StagingRing* staging_;
+    ThreadPool& pool_;
+    // chunk coordinates -> latest requested mesh
+    std::unordered_map<glm::ivec3, Pending> pending_;
+    uint64_t nextVersion_;
+    // jobs are reused (with their grown buffers) so meshing doesn't allocate
+    std::vector<std::unique_ptr<Job>> jobs_;
+    std::vector<Job*> free_;
+    int running_; // jobs handed to the pool and not collected yet
+
+    std::mutex completedMutex_;
+    std::condition_variable completedCond_;
+    std::vector<Job*> completed_;
+    std::vector<Job*> collected_; // main thread copy of completed_
+
+public:
+    MeshScheduler(StagingRing* staging = nullptr, ThreadPool& pool = ThreadPool::instance());
+    ~MeshScheduler();
+
+    // snapshots the chunk and queues it for meshing, call from the main thread,
+    // lod and seams are passed on to ChunkSnapshot::gather
+    void schedule(Chunk* chunk, glm::ivec3 chunkPos, MeshingMode mode = MeshingMode::greedy, int lod = 0, uint8_t seams = 0);
+    // drops the pending mesh of the chunk, has to be called before the chunk is deleted
+    void forget(glm::ivec3 chunkPos);
+    // uploads at most maxUploads finished meshes, returns how many were uploaded
+    int upload(int maxUploads = INT_MAX);
+    // blocks until every scheduled chunk has been meshed and uploaded
+    void finish();
+
+    int pending() const { return pending_.size(); }
+
+private:
+    void collect(bool block);
+    void recycle(Job* job);
+};
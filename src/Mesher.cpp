@@ -0,0 +1,331 @@
+#include "Mesher.h"
+
+#include <array>
+#include <bit>
+
+#include "tracy/Tracy.hpp"
+#include "BlockRegistry.h"
+#include "ChunkStorage.h"
+
+// offsets of the neighbour in each face direction inside of a snapshot
+static const int NEIGHBOUR_OFFSETS[6] = {
+    1, -1, ChunkSnapshot::SIZE, -ChunkSnapshot::SIZE, ChunkSnapshot::SIZE_POW2, -ChunkSnapshot::SIZE_POW2
+};
+
+// face id stored in the vertices for each direction
+static const int FACE_IDS[6] = {3, 2, 4, 5, 1, 0};
+// corners of the face in each direction as offsets scaled by the face size, in vertex order
+static const glm::ivec3 FACE_CORNERS[6][4] = {
+    {{1, 0, 0}, {1, 0, 1}, {1, 1, 1}, {1, 1, 0}},
+    {{0, 0, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1}},
+    {{0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}},
+    {{0, 0, 0}, {0, 0, 1}, {1, 0, 1}, {1, 0, 0}},
+    {{0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1}},
+    {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}},
+};
+
+Mesher::Mesher(MeshData& mesh)
+    : mesh_(mesh), snapshot_(nullptr), size_(Consts::CHUNK_SIZE), fullColumn_(0)
+{}
+
+void Mesher::build(const ChunkSnapshot& snapshot, MeshingMode mode) {
+    snapshot_ = &snapshot;
+    size_ = snapshot.size;
+    fullColumn_ = Column(~Column(0)) >> (sizeof(Column)*8 - size_);
+    mesh_.lod = snapshot.lod;
+    switch (mode) {
+        case MeshingMode::naive:
+            buildNaive(snapshot);
+            break;
+        case MeshingMode::bitmask:
+            buildBitmask(snapshot);
+            break;
+        case MeshingMode::greedy:
+            buildGreedy(snapshot);
+            break;
+    }
+}
+
+void Mesher::buildNaive(const ChunkSnapshot& snapshot) {
+    ZoneScopedN("Mesher::buildNaive");
+    for (int z1 = 0; z1 < size_; z1++) {
+        for (int y1 = 0; y1 < size_; y1++) {
+            for (int x1 = 0; x1 < size_; x1++) {
+                const Block* bp = &snapshot.blocks[ChunkSnapshot::index(x1, y1, z1)];
+                Block b = *bp;
+                uint8_t opaqueBitmask = 0;
+
+                if (b.id == 0) {
+                    continue;
+                }
+
+                const Block bpx = bp[1];
+                const Block bnx = bp[-1];
+                const Block bpy = bp[ChunkSnapshot::SIZE];
+                const Block bny = bp[-ChunkSnapshot::SIZE];
+                const Block bpz = bp[ChunkSnapshot::SIZE_POW2];
+                const Block bnz = bp[-ChunkSnapshot::SIZE_POW2];
+                
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bpx.id) ? ADJACENT_BITMASK_POS_X : 0;
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bnx.id) ? ADJACENT_BITMASK_NEG_X : 0;
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bpy.id) ? ADJACENT_BITMASK_POS_Y : 0;
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bny.id) ? ADJACENT_BITMASK_NEG_Y : 0;
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bpz.id) ? ADJACENT_BITMASK_POS_Z : 0;
+                opaqueBitmask |= BlockRegistry::faceVisible(b.id, bnz.id) ? ADJACENT_BITMASK_NEG_Z : 0;
+
+                while (opaqueBitmask) {
+                    addFace(x1, y1, z1, std::countr_zero(opaqueBitmask));
+                    opaqueBitmask &= opaqueBitmask - 1;
+                }
+            }
+        }
+    }
+}
+
+bool Mesher::cullFaces(const ChunkSnapshot& snapshot, FaceColumns& faces) {
+    ZoneScopedN("Mesher::cullFaces");
+    const int S = size_;
+    const int P = ChunkSnapshot::SIZE;
+    // one column of bits along x for every y, z of the snapshot including the padding,
+    // the padding voxels at x = -1 and x = size_ are kept separately for the inner rows
+    std::array<Column, ChunkSnapshot::SIZE_POW2> opaque{}, visible{};
+    std::array<Column, Consts::CHUNK_SIZE_POW2> opaqueLow{}, opaqueHigh{};
+    auto row = [](int y, int z) { return (y+1) + (z+1)*ChunkSnapshot::SIZE; };
+
+    // a chunk of a single block only needs its padding looked at
+    const uint8_t uniformFlags = BlockRegistry::flags(snapshot.at(0, 0, 0).id);
+    if (snapshot.uniform && !(uniformFlags & BlockRegistry::FLAG_VISIBLE)) {
+        return false;
+    }
+
+    for (int z = -1; z <= S; z++) {
+        for (int y = -1; y <= S; y++) {
+            const Block* blocks = &snapshot.blocks[ChunkSnapshot::index(0, y, z)];
+            const bool inner = y >= 0 && y < S && z >= 0 && z < S;
+            Column o = 0, v = 0;
+            if (inner && snapshot.uniform) {
+                o = (uniformFlags & BlockRegistry::FLAG_OPAQUE) ? fullColumn_ : 0;
+                v = fullColumn_;
+            } else {
+                for (int x = 0; x < S; x++) {
+                    uint8_t flags = BlockRegistry::flags(blocks[x].id);
+                    o |= (Column)(flags & BlockRegistry::FLAG_OPAQUE) << x;
+                    v |= (Column)(flags >> 1) << x;
+                }
+            }
+            opaque[row(y, z)] = o;
+            visible[row(y, z)] = v;
+            if (inner) {
+                opaqueLow[y + z*S] = BlockRegistry::flags(blocks[-1].id) & BlockRegistry::FLAG_OPAQUE;
+                opaqueHigh[y + z*S] = (Column)(BlockRegistry::flags(blocks[S].id) & BlockRegistry::FLAG_OPAQUE) << (S-1);
+            }
+        }
+    }
+
+    bool any = false;
+    for (int z = 0; z < S; z++) {
+        for (int y = 0; y < S; y++) {
+            const int r = row(y, z);
+            const int c = y + z*S;
+            const Column v = visible[r];
+            const Column o = opaque[r];
+            // a face is visible where the voxel is and its neighbour in the direction isn't opaque,
+            // along x that is the shifted column, along y and z the neighbouring column
+            faces[0][c] = v & ~((o >> 1) | opaqueHigh[c]);
+            faces[1][c] = v & ~(((o << 1) & fullColumn_) | opaqueLow[c]);
+            faces[2][c] = v & ~opaque[r + 1];
+            faces[3][c] = v & ~opaque[r - 1];
+            faces[4][c] = v & ~opaque[r + P];
+            faces[5][c] = v & ~opaque[r - P];
+
+            // transparent blocks only hide faces of the same block next to them
+            Column transparent = v & ~o;
+            while (transparent) {
+                int x = std::countr_zero(transparent);
+                transparent &= transparent - 1;
+                const Block* bp = &snapshot.blocks[ChunkSnapshot::index(x, y, z)];
+                for (int dir = 0; dir < 6; dir++) {
+                    if (bp[NEIGHBOUR_OFFSETS[dir]] == *bp) {
+                        faces[dir][c] &= ~((Column)1 << x);
+                    }
+                }
+            }
+            any |= v != 0;
+        }
+    }
+    return any;
+}
+
+void Mesher::buildBitmask(const ChunkSnapshot& snapshot) {
+    ZoneScopedN("Mesher::buildBitmask");
+    FaceColumns faces;
+    if (!cullFaces(snapshot, faces)) {
+        return;
+    }
+    for (int dir = 0; dir < 6; dir++) {
+        for (int c = 0; c < size_ * size_; c++) {
+            Column bits = faces[dir][c];
+            while (bits) {
+                addFace(std::countr_zero(bits), c % size_, c / size_, dir);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+void Mesher::buildGreedy(const ChunkSnapshot& snapshot) {
+    ZoneScopedN("Mesher::buildGreedy");
+    const int S = size_;
+    FaceColumns faces;
+    if (!cullFaces(snapshot, faces)) {
+        return;
+    }
+
+    // Every direction is merged slice by slice along its normal. A slice is a plane of
+    // columns indexed by v with bits indexed by u:
+    //   x faces: slice x, u = y, v = z
+    //   y faces: slice y, u = x, v = z
+    //   z faces: slice z, u = x, v = y
+    // the x faces are transposed first, the y and z ones already have their bits along x
+    std::array<Column, Consts::CHUNK_SIZE_POW2> planes;
+    auto toLocal = [](int dir, int slice, int u, int v) -> glm::ivec3 {
+        switch (dir >> 1) {
+            case 0: return {slice, u, v};
+            case 1: return {u, slice, v};
+            default: return {u, v, slice};
+        }
+    };
+
+    for (int dir = 0; dir < 6; dir++) {
+        // planes[slice*S + v]
+        if (dir < 2) {
+            planes.fill(0);
+            for (int c = 0; c < S * S; c++) {
+                Column bits = faces[dir][c];
+                const int y = c % S;
+                const int z = c / S;
+                while (bits) {
+                    int x = std::countr_zero(bits);
+                    bits &= bits - 1;
+                    planes[x*S + z] |= (Column)1 << y;
+                }
+            }
+        } else if (dir < 4) {
+            for (int z = 0; z < S; z++)
+                for (int y = 0; y < S; y++)
+                    planes[y*S + z] = faces[dir][y + z*S];
+        } else {
+            planes = faces[dir];
+        }
+
+        for (int slice = 0; slice < S; slice++) {
+            Column* plane = &planes[slice*S];
+            for (int v = 0; v < S; v++) {
+                while (plane[v]) {
+                    const int u = std::countr_zero(plane[v]);
+                    glm::ivec3 p = toLocal(dir, slice, u, v);
+                    const Block block = snapshot.at(p.x, p.y, p.z);
+                    const uint8_t ao = faceAo(p.x, p.y, p.z, dir);
+                    // faces only merge when they are lit the same across the whole face,
+                    // a merged quad would stretch the occlusion gradient of one face over all of them
+                    const bool mergeable = ao == (ao & 3) * 0b01010101;
+                    auto sameFace = [&](int u, int v) {
+                        glm::ivec3 p = toLocal(dir, slice, u, v);
+                        return snapshot.at(p.x, p.y, p.z) == block && faceAo(p.x, p.y, p.z, dir) == ao;
+                    };
+
+                    // grow along u over set bits of the same face, then along v while
+                    // the whole run is present and made of the same faces
+                    int w = 1;
+                    while (mergeable && u + w < S && (plane[v] >> (u + w) & 1) && sameFace(u + w, v)) {
+                        w++;
+                    }
+                    const Column run = (w == S ? fullColumn_ : (((Column)1 << w) - 1)) << u;
+                    plane[v] &= ~run;
+
+                    int h = 1;
+                    for (; mergeable && v + h < S && (plane[v + h] & run) == run; h++) {
+                        bool same = true;
+                        for (int i = 0; i < w && same; i++) {
+                            same = sameFace(u + i, v + h);
+                        }
+                        if (!same) {
+                            break;
+                        }
+                        plane[v + h] &= ~run;
+                    }
+
+                    glm::ivec3 size = toLocal(dir, 1, w, h);
+                    addFace(p.x, p.y, p.z, dir, size.x, size.y, size.z, ao);
+                }
+            }
+        }
+    }
+}
+
+// snapshot index offsets of the two edge voxels and the diagonal voxel in front of each face corner
+struct AoOffsets {
+    int offsets[6][4][3];
+
+    AoOffsets() {
+        auto toOffset = [](glm::ivec3 p) { return p.x + p.y*ChunkSnapshot::SIZE + p.z*ChunkSnapshot::SIZE_POW2; };
+        for (int dir = 0; dir < 6; dir++) {
+            const int axis = dir >> 1;
+            const int a = (axis + 1) % 3, b = (axis + 2) % 3;
+            glm::ivec3 front(0, 0, 0);
+            front[axis] = (dir & 1) ? -1 : 1;
+            for (int i = 0; i < 4; i++) {
+                glm::ivec3 da(0, 0, 0), db(0, 0, 0);
+                da[a] = FACE_CORNERS[dir][i][a] ? 1 : -1;
+                db[b] = FACE_CORNERS[dir][i][b] ? 1 : -1;
+                offsets[dir][i][0] = toOffset(front + da);
+                offsets[dir][i][1] = toOffset(front + db);
+                offsets[dir][i][2] = toOffset(front + da + db);
+            }
+        }
+    }
+};
+static const AoOffsets AO_OFFSETS;
+
+uint8_t Mesher::faceAo(int x, int y, int z, int dir) const {
+    const Block* bp = &snapshot_->blocks[ChunkSnapshot::index(x, y, z)];
+    auto occludes = [&](int offset) -> int {
+        return BlockRegistry::flags(bp[offset].id) & BlockRegistry::FLAG_OPAQUE;
+    };
+
+    uint8_t ao = 0;
+    for (int i = 0; i < 4; i++) {
+        const int* offsets = AO_OFFSETS.offsets[dir][i];
+        int side1 = occludes(offsets[0]), side2 = occludes(offsets[1]);
+        int value = (side1 && side2) ? 0 : 3 - (side1 + side2 + occludes(offsets[2]));
+        ao |= value << (i * 2);
+    }
+    return ao;
+}
+
+void Mesher::addFace(int x, int y, int z, int dir, int sx, int sy, int sz) {
+    addFace(x, y, z, dir, sx, sy, sz, faceAo(x, y, z, dir));
+}
+
+void Mesher::addFace(int x, int y, int z, int dir, int sx, int sy, int sz, uint8_t ao) {
+    const BlockType& type = BlockRegistry::get(snapshot_->at(x, y, z).id);
+    const int layer = dir == 2 ? type.topLayer : (dir == 3 ? type.bottomLayer : type.sideLayer);
+    glm::ivec3 size(sx, sy, sz);
+    size[dir >> 1] = 1;
+
+    // split the quad along the diagonal with the smaller difference in occlusion,
+    // the QuadIndexBuffer pattern is fixed so the vertices are rotated instead
+    int ao0 = ao & 3, ao1 = (ao >> 2) & 3, ao2 = (ao >> 4) & 3, ao3 = ao >> 6;
+    int first = (ao0 + ao2 < ao1 + ao3) ? 1 : 0;
+
+    const unsigned int io = mesh_.vertices.size();
+    const uint32_t base = PackedVertex::pack(x, y, z, FACE_IDS[dir], 0, layer);
+    mesh_.vertices.resize(io + 4);
+    uint32_t* vertices = &mesh_.vertices[io];
+    for (int i = 0; i < 4; i++) {
+        const int corner = (i + first) & 3;
+        const glm::ivec3& c = FACE_CORNERS[dir][corner];
+        // the fields can't overflow into each other, so the offsets are simply added
+        vertices[i] = base + PackedVertex::pack(c.x*size.x, c.y*size.y, c.z*size.z, 0, (ao >> (corner * 2)) & 3, 0);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ChunkSnapshot.h"
+#include "WorldConstants.h"
+
+enum class MeshingMode {
+    naive,   // visits every voxel and checks its six neighbours
+    bitmask, // culls whole columns of voxels at once with bit operations
+    greedy,  // culls like bitmask and merges neighbouring faces of the same block into rectangles
+};
+
+/*
+ * Chunk vertices are packed into a single 32-bit int, decoded in res/shaders/basic.vert:
+ *   bits  0-17  chunk-local position, 6 bits per axis (0..CHUNK_SIZE), in voxels of the mesh level of detail
+ *   bits 18-20  face id (indexes the normals in the shader)
+ *   bits 21-22  ambient occlusion, 0 is fully occluded, 3 not occluded
+ *   bits 23-31  texture array layer
+ * uvs are derived from the position in the shader, the chunk origin and the level of detail
+ * (the position is scaled by 2^lod) come with every draw, see ChunkRenderer
+ */
+struct PackedVertex {
+    static_assert(Consts::CHUNK_SIZE < 64, "chunk-local positions have to fit in 6 bits");
+
+    static constexpr uint32_t pack(int x, int y, int z, int face, int ao, int layer) {
+        return x | (y << 6) | (z << 12) | (face << 18) | (ao << 21) | ((uint32_t)layer << 23);
+    }
+};
+
+// quads as 4 consecutive vertices each, indexed by the QuadIndexBuffer
+struct MeshData {
+    std::vector<uint32_t> vertices;
+    int lod = 0; // of the snapshot the mesh was built from
+
+    void clear() {
+        vertices.clear();
+    }
+    unsigned int quadCount() const { return vertices.size() / 4; }
+};
+
+// Builds the mesh of a chunk snapshot in chunk-local coordinates
+class Mesher {
+    MeshData& mesh_;
+    const ChunkSnapshot* snapshot_;
+
+    static const uint8_t ADJACENT_BITMASK_POS_X = 0b00000001;
+    static const uint8_t ADJACENT_BITMASK_NEG_X = 0b00000010;
+    static const uint8_t ADJACENT_BITMASK_POS_Y = 0b00000100;
+    static const uint8_t ADJACENT_BITMASK_NEG_Y = 0b00001000;
+    static const uint8_t ADJACENT_BITMASK_POS_Z = 0b00010000;
+    static const uint8_t ADJACENT_BITMASK_NEG_Z = 0b00100000;
+
+    // one bit per voxel of a chunk column
+    static_assert(Consts::CHUNK_SIZE <= 64, "bitmask mesher supports chunks up to 64 voxels");
+    using Column = std::conditional_t<(Consts::CHUNK_SIZE <= 32), uint32_t, uint64_t>;
+    // visible faces of each direction as columns along x, indexed by [dir][y + z*size_]
+    using FaceColumns = std::array<std::array<Column, Consts::CHUNK_SIZE_POW2>, 6>;
+
+    int size_;          // voxels along each axis of the snapshot, smaller at lower levels of detail
+    Column fullColumn_; // size_ bits set
+public:
+    Mesher(MeshData& mesh);
+
+    void build(const ChunkSnapshot& snapshot, MeshingMode mode);
+
+private:
+    void buildNaive(const ChunkSnapshot& snapshot);
+    void buildBitmask(const ChunkSnapshot& snapshot);
+    void buildGreedy(const ChunkSnapshot& snapshot);
+    // fills faces with the visible faces of the snapshot, returns false if there are none
+    bool cullFaces(const ChunkSnapshot& snapshot, FaceColumns& faces);
+
+    // ambient occlusion of the four corners of a face (2 bits each, in the vertex order of addFace)
+    uint8_t faceAo(int x, int y, int z, int dir) const;
+    // emits a face of local voxel x, y, z facing direction dir (0..5 as the ADJACENT_BITMASK bits),
+    // merged faces span sx, sy, sz voxels (the size along the normal is ignored)
+    void addFace(int x, int y, int z, int dir, int sx = 1, int sy = 1, int sz = 1);
+    void addFace(int x, int y, int z, int dir, int sx, int sy, int sz, uint8_t ao);
+};
@@ -0,0 +1,278 @@
+#include "Noise.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NOISE_X86 1
+#endif
+
+
+namespace {
+
+constexpr float F2 = 0.366025403f; // (sqrt(3) - 1) / 2, skews the grid to simplices
+constexpr float G2 = 0.211324865f; // (3 - sqrt(3)) / 6, unskews back
+constexpr float F3 = 1.0f / 3.0f;
+constexpr float G3 = 1.0f / 6.0f;
+constexpr float SCALE2 = 70.0f;    // stretches the sums to about -1..1
+constexpr float SCALE3 = 32.0f;
+
+constexpr uint32_t PRIME_X = 0x8DA6B343u;
+constexpr uint32_t PRIME_Y = 0xD8163841u;
+constexpr uint32_t PRIME_Z = 0xCB1AB31Fu;
+constexpr uint32_t HASH_MUL = 0x27D4EB2Du;
+
+/*
+ * The algorithms are written once over N lanes with gcc vector extensions, N = 1 is the
+ * scalar reference. Every helper is always inlined so it's compiled for the instruction
+ * set of the function it ends up in.
+ */
+template<int N>
+struct Lanes {
+    typedef float F __attribute__((vector_size(N * sizeof(float))));
+    typedef int32_t I __attribute__((vector_size(N * sizeof(int32_t))));
+    typedef uint32_t U __attribute__((vector_size(N * sizeof(uint32_t))));
+};
+
+#define NOISE_INLINE [[gnu::always_inline]] inline
+
+template<class F, class I>
+NOISE_INLINE F toFloat(I v) { return __builtin_convertvector(v, F); }
+
+template<class I, class F>
+NOISE_INLINE I toInt(F v) { return __builtin_convertvector(v, I); }
+
+// truncates and corrects the negative values, exact for the range of int
+template<class F, class I>
+NOISE_INLINE I floorInt(F x) {
+    I i = toInt<I>(x);
+    return i + ((toFloat<F>(i) > x) & -1);
+}
+
+// flips the sign of the lanes whose mask bit is set
+template<class F, class I>
+NOISE_INLINE F negateIf(F v, I bit) {
+    return (F)((I)v ^ (bit << 31));
+}
+
+template<class U>
+NOISE_INLINE U mix(U h) {
+    h *= HASH_MUL;
+    return h ^ (h >> 15);
+}
+
+// one of 8 gradients: the 4 diagonals and the 4 axes
+template<class F, class I>
+NOISE_INLINE F grad2(I h, F x, F y) {
+    I flipX = h & 1, flipY = (h >> 1) & 1;
+    F diagonal = negateIf(x, flipX) + negateIf(y, flipY);
+    F axis = negateIf(flipY ? y : x, flipX);
+    return (h & 4) ? axis : diagonal;
+}
+
+// one of the 12 cube edge gradients
+template<class F, class I>
+NOISE_INLINE F grad3(I h, F x, F y, F z) {
+    F u = h < 8 ? x : y;
+    F v = h < 4 ? y : ((h == 12) | (h == 14)) ? x : z;
+    return negateIf(u, h & 1) + negateIf(v, (h >> 1) & 1);
+}
+
+template<class F, class I>
+NOISE_INLINE F falloff(F t, F contribution) {
+    F t2 = t * t;
+    F value = t2 * t2 * contribution;
+    return t < 0.0f ? F{} : value;
+}
+
+template<int N>
+NOISE_INLINE typename Lanes<N>::F simplex2(typename Lanes<N>::F x, typename Lanes<N>::F y, uint32_t seed) {
+    using F = typename Lanes<N>::F;
+    using I = typename Lanes<N>::I;
+    using U = typename Lanes<N>::U;
+
+    // the cell of the skewed grid and the distance to its origin
+    F s = (x + y) * F2;
+    I i = floorInt<F, I>(x + s);
+    I j = floorInt<F, I>(y + s);
+    F t = toFloat<F>(i + j) * G2;
+    F x0 = x - (toFloat<F>(i) - t);
+    F y0 = y - (toFloat<F>(j) - t);
+
+    // the middle corner is one step along x or y, whichever is further
+    I i1 = (x0 > y0) & 1;
+    I j1 = 1 - i1;
+    F x1 = x0 - toFloat<F>(i1) + G2;
+    F y1 = y0 - toFloat<F>(j1) + G2;
+    F x2 = x0 + (2.0f * G2 - 1.0f);
+    F y2 = y0 + (2.0f * G2 - 1.0f);
+
+    U hx = (U)i * PRIME_X;
+    U hy = (U)j * PRIME_Y;
+    I h0 = (I)mix<U>(hx ^ hy ^ seed);
+    I h1 = (I)mix<U>((hx + (U)i1 * PRIME_X) ^ (hy + (U)j1 * PRIME_Y) ^ seed);
+    I h2 = (I)mix<U>((hx + PRIME_X) ^ (hy + PRIME_Y) ^ seed);
+
+    F n0 = falloff<F, I>(0.5f - x0 * x0 - y0 * y0, grad2(h0, x0, y0));
+    F n1 = falloff<F, I>(0.5f - x1 * x1 - y1 * y1, grad2(h1, x1, y1));
+    F n2 = falloff<F, I>(0.5f - x2 * x2 - y2 * y2, grad2(h2, x2, y2));
+    return (n0 + n1 + n2) * SCALE2;
+}
+
+template<int N>
+NOISE_INLINE typename Lanes<N>::F simplex3(typename Lanes<N>::F x, typename Lanes<N>::F y, typename Lanes<N>::F z, uint32_t seed) {
+    using F = typename Lanes<N>::F;
+    using I = typename Lanes<N>::I;
+    using U = typename Lanes<N>::U;
+
+    F s = (x + y + z) * F3;
+    I i = floorInt<F, I>(x + s);
+    I j = floorInt<F, I>(y + s);
+    I k = floorInt<F, I>(z + s);
+    F t = toFloat<F>(i + j + k) * G3;
+    F x0 = x - (toFloat<F>(i) - t);
+    F y0 = y - (toFloat<F>(j) - t);
+    F z0 = z - (toFloat<F>(k) - t);
+
+    // the two middle corners follow the axes sorted by distance, without branches
+    I xy = x0 >= y0, yz = y0 >= z0, xz = x0 >= z0;
+    I i1 = xy & xz & 1;
+    I j1 = ~xy & yz & 1;
+    I k1 = 1 - i1 - j1;
+    I i2 = (xy | xz) & 1;
+    I j2 = (~xy | yz) & 1;
+    I k2 = 2 - i2 - j2;
+
+    F x1 = x0 - toFloat<F>(i1) + G3;
+    F y1 = y0 - toFloat<F>(j1) + G3;
+    F z1 = z0 - toFloat<F>(k1) + G3;
+    F x2 = x0 - toFloat<F>(i2) + 2.0f * G3;
+    F y2 = y0 - toFloat<F>(j2) + 2.0f * G3;
+    F z2 = z0 - toFloat<F>(k2) + 2.0f * G3;
+    F x3 = x0 + (3.0f * G3 - 1.0f);
+    F y3 = y0 + (3.0f * G3 - 1.0f);
+    F z3 = z0 + (3.0f * G3 - 1.0f);
+
+    U hx = (U)i * PRIME_X;
+    U hy = (U)j * PRIME_Y;
+    U hz = (U)k * PRIME_Z;
+    I h0 = (I)mix<U>(hx ^ hy ^ hz ^ seed) & 15;
+    I h1 = (I)mix<U>((hx + (U)i1 * PRIME_X) ^ (hy + (U)j1 * PRIME_Y) ^ (hz + (U)k1 * PRIME_Z) ^ seed) & 15;
+    I h2 = (I)mix<U>((hx + (U)i2 * PRIME_X) ^ (hy + (U)j2 * PRIME_Y) ^ (hz + (U)k2 * PRIME_Z) ^ seed) & 15;
+    I h3 = (I)mix<U>((hx + PRIME_X) ^ (hy + PRIME_Y) ^ (hz + PRIME_Z) ^ seed) & 15;
+
+    F n0 = falloff<F, I>(0.6f - x0 * x0 - y0 * y0 - z0 * z0, grad3(h0, x0, y0, z0));
+    F n1 = falloff<F, I>(0.6f - x1 * x1 - y1 * y1 - z1 * z1, grad3(h1, x1, y1, z1));
+    F n2 = falloff<F, I>(0.6f - x2 * x2 - y2 * y2 - z2 * z2, grad3(h2, x2, y2, z2));
+    F n3 = falloff<F, I>(0.6f - x3 * x3 - y3 * y3 - z3 * z3, grad3(h3, x3, y3, z3));
+    return (n0 + n1 + n2 + n3) * SCALE3;
+}
+
+template<int N>
+NOISE_INLINE typename Lanes<N>::F load(const float* p) {
+    typename Lanes<N>::F v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template<int N>
+NOISE_INLINE void store(float* p, typename Lanes<N>::F v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// BATCH samples with N lanes at a time
+template<int N>
+NOISE_INLINE void batch2(const float* x, const float* y, float* out, uint32_t seed) {
+    for (int i = 0; i < Noise::BATCH; i += N) {
+        store<N>(out + i, simplex2<N>(load<N>(x + i), load<N>(y + i), seed));
+    }
+}
+
+template<int N>
+NOISE_INLINE void batch3(const float* x, const float* y, const float* z, float* out, uint32_t seed) {
+    for (int i = 0; i < Noise::BATCH; i += N) {
+        store<N>(out + i, simplex3<N>(load<N>(x + i), load<N>(y + i), load<N>(z + i), seed));
+    }
+}
+
+#ifdef NOISE_X86
+__attribute__((target("avx2")))
+void batch2Avx2(const float* x, const float* y, float* out, uint32_t seed) { batch2<8>(x, y, out, seed); }
+__attribute__((target("avx2")))
+void batch3Avx2(const float* x, const float* y, const float* z, float* out, uint32_t seed) { batch3<8>(x, y, z, out, seed); }
+
+__attribute__((target("sse4.1")))
+void batch2Sse41(const float* x, const float* y, float* out, uint32_t seed) { batch2<4>(x, y, out, seed); }
+__attribute__((target("sse4.1")))
+void batch3Sse41(const float* x, const float* y, const float* z, float* out, uint32_t seed) { batch3<4>(x, y, z, out, seed); }
+#endif
+
+Noise::Backend bestBackend() {
+    if (Noise::isSupported(Noise::Backend::avx2))
+        return Noise::Backend::avx2;
+    if (Noise::isSupported(Noise::Backend::sse41))
+        return Noise::Backend::sse41;
+    return Noise::Backend::scalar;
+}
+
+}
+
+
+Noise::Backend Noise::s_backend = bestBackend();
+
+Noise::Noise(uint32_t seed) : seed_(seed) {
+}
+
+bool Noise::isSupported(Backend backend) {
+    switch (backend) {
+#ifdef NOISE_X86
+        case Backend::avx2: return __builtin_cpu_supports("avx2");
+        case Backend::sse41: return __builtin_cpu_supports("sse4.1");
+#endif
+        case Backend::scalar: return true;
+        default: return false;
+    }
+}
+
+bool Noise::setBackend(Backend backend) {
+    if (!isSupported(backend)) {
+        return false;
+    }
+    s_backend = backend;
+    return true;
+}
+
+const char* Noise::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::avx2: return "AVX2";
+        case Backend::sse41: return "SSE4.1";
+        default: return "Scalar";
+    }
+}
+
+float Noise::simplex2(float x, float y) const {
+    return ::simplex2<1>(Lanes<1>::F{x}, Lanes<1>::F{y}, seed_)[0];
+}
+
+float Noise::simplex3(float x, float y, float z) const {
+    return ::simplex3<1>(Lanes<1>::F{x}, Lanes<1>::F{y}, Lanes<1>::F{z}, seed_)[0];
+}
+
+void Noise::simplex2(const float* x, const float* y, float* out) const {
+    switch (s_backend) {
+#ifdef NOISE_X86
+        case Backend::avx2: batch2Avx2(x, y, out, seed_); return;
+        case Backend::sse41: batch2Sse41(x, y, out, seed_); return;
+#endif
+        default: batch2<1>(x, y, out, seed_); return;
+    }
+}
+
+void Noise::simplex3(const float* x, const float* y, const float* z, float* out) const {
+    switch (s_backend) {
+#ifdef NOISE_X86
+        case Backend::avx2: batch3Avx2(x, y, z, out, seed_); return;
+        case Backend::sse41: batch3Sse41(x, y, z, out, seed_); return;
+#endif
+        default: batch3<1>(x, y, z, out, seed_); return;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+#include "WorldConstants.h"
+
+/*
+ * Seeded simplex noise in 2D and 3D, values are roughly in -1..1
+ *
+ * The batched calls evaluate BATCH samples at once with the widest instructions the cpu
+ * supports (AVX2, SSE4.1 or plain scalar code), picked at runtime. All backends run the
+ * same operations in the same order, so they return bit identical values and the
+ * terrain doesn't depend on the machine it was generated on.
+ */
+class Noise {
+public:
+    static constexpr int BATCH = 8;
+
+    enum class Backend { scalar, sse41, avx2 };
+
+private:
+    uint32_t seed_;
+    static Backend s_backend;
+
+public:
+    Noise(uint32_t seed = Consts::DEFAULT_SEED);
+
+    float simplex2(float x, float y) const;
+    float simplex3(float x, float y, float z) const;
+    // BATCH samples per call, every pointer points to BATCH floats
+    void simplex2(const float* x, const float* y, float* out) const;
+    void simplex3(const float* x, const float* y, const float* z, float* out) const;
+
+    uint32_t seed() const { return seed_; }
+
+    // the backend used by the batched calls, defaults to the best supported one
+    static Backend backend() { return s_backend; }
+    // returns false (and keeps the current one) if the cpu doesn't support the backend
+    static bool setBackend(Backend backend);
+    static bool isSupported(Backend backend);
+    static const char* backendName(Backend backend);
+};
@@ -0,0 +1,31 @@
+#include "QuadIndexBuffer.h"
+
+#include <vector>
+
+#include "EBO.h"
+#include "tracy/Tracy.hpp"
+
+
+static EBO* s_ebo = nullptr;
+
+void QuadIndexBuffer::bind() {
+    if (s_ebo) {
+        s_ebo->bind();
+        return;
+    }
+    ZoneScopedN("QuadIndexBuffer::create");
+    std::vector<unsigned int> indices;
+    indices.reserve(MAX_QUADS * INDICES_PER_QUAD);
+    for (unsigned int io = 0; io < MAX_QUADS * 4; io += 4) {
+        indices.insert(indices.end(), {
+            io, io+1, io+2,
+            io, io+2, io+3
+        });
+    }
+    s_ebo = new EBO(indices);
+}
+
+void QuadIndexBuffer::remove() {
+    delete s_ebo;
+    s_ebo = nullptr;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "WorldConstants.h"
+
+/*
+ * Index buffer shared by all of the chunk meshes
+ *
+ * Every quad of a mesh is 4 consecutive vertices split into the triangles
+ * (0, 1, 2) and (0, 2, 3), so the indices are the same for every chunk
+ * and only the vertices have to be meshed and uploaded.
+ */
+class QuadIndexBuffer {
+public:
+    // the most quads a chunk can have, faces between two different transparent blocks are
+    // drawn from both sides so every voxel can show all of its 6 faces
+    static constexpr unsigned int MAX_QUADS = Consts::CHUNK_SIZE_POW3 * 6;
+    static constexpr unsigned int INDICES_PER_QUAD = 6;
+
+    // binds the buffer to the currently bound VAO, creates it on the first call
+    static void bind();
+    static void remove();
+};
@@ -0,0 +1,155 @@
+#include "Raycaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "tracy/Tracy.hpp"
+#include "World.h"
+
+
+Raycaster::Raycaster() : chunkPos_(0, 0, 0), chunk_(nullptr), empty_(true), cached_(false), decodedPos_(0, 0, 0), hasDecoded_(false) {
+}
+
+void Raycaster::lookup(glm::ivec3 chunkPos) {
+    if (cached_ && chunkPos == chunkPos_) {
+        return;
+    }
+    chunkPos_ = chunkPos;
+    chunk_ = World::findChunk(chunkPos);
+    if (!chunk_ && hasDecoded_ && decodedPos_ == chunkPos) {
+        chunk_ = &decoded_;
+    } else if (!chunk_ && World::readChunk(chunkPos, decoded_)) {
+        decodedPos_ = chunkPos;
+        hasDecoded_ = true;
+        chunk_ = &decoded_;
+    }
+    cached_ = true;
+    empty_ = true;
+    if (chunk_) {
+        // the palette may still hold blocks that were removed since, so this only skips for sure empty chunks
+        for (Block block : chunk_->palette()) {
+            if (block.id != Consts::BlockIDs::air) {
+                empty_ = false;
+                break;
+            }
+        }
+    }
+}
+
+bool Raycaster::cast(const Ray& ray, RaycastHit& hit) {
+    cached_ = false;
+    hasDecoded_ = false;
+    return castCached(ray, hit);
+}
+
+bool Raycaster::castCached(const Ray& ray, RaycastHit& hit) {
+    const int S = Consts::CHUNK_SIZE;
+    const int B = ChunkStorage::BRICK;
+    float length = glm::length(ray.direction);
+    if (length == 0.0f) {
+        return false;
+    }
+    const glm::vec3 origin = ray.origin;
+    const glm::vec3 dir = ray.direction / length;
+    const float INF = std::numeric_limits<float>::infinity();
+
+    // t of the next voxel boundary on each axis and the t between two of them
+    glm::ivec3 voxel = glm::ivec3(glm::floor(origin));
+    glm::ivec3 step;
+    glm::vec3 tMax, tDelta, invDir;
+    for (int k = 0; k < 3; k++) {
+        step[k] = dir[k] > 0.0f ? 1 : (dir[k] < 0.0f ? -1 : 0);
+        invDir[k] = step[k] ? 1.0f / dir[k] : INF;
+        tDelta[k] = std::fabs(invDir[k]);
+        tMax[k] = step[k] ? ((float)(voxel[k] + (step[k] > 0)) - origin[k]) * invDir[k] : INF;
+    }
+    glm::ivec3 normal(0, 0, 0);
+    float t = 0.0f;
+
+    while (t <= ray.maxDistance) {
+        glm::ivec3 chunkPos = World::toChunkPos(voxel);
+        glm::ivec3 base = chunkPos * S;
+        lookup(chunkPos);
+
+        // the empty box the ray crosses in a single step, the whole chunk or the brick of the voxel
+        glm::ivec3 lo = base;
+        int size = S;
+        if (!empty_) {
+            glm::ivec3 local = voxel - base;
+            lo = base + local / B * B;
+            size = B;
+            if (!chunk_->isBrickEmpty(local.x, local.y, local.z)) {
+                // walks the voxels until a solid one or the ray leaves the brick
+                while (true) {
+                    local = voxel - base;
+                    Block block = chunk_->get(local.x, local.y, local.z);
+                    if (block.id != Consts::BlockIDs::air) {
+                        hit = {block, voxel, normal, t};
+                        return true;
+                    }
+                    int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+                    t = tMax[axis];
+                    if (t > ray.maxDistance) {
+                        return false;
+                    }
+                    voxel[axis] += step[axis];
+                    tMax[axis] += tDelta[axis];
+                    normal = glm::ivec3(0, 0, 0);
+                    normal[axis] = -step[axis];
+                    if ((unsigned int)(voxel[axis] - lo[axis]) >= (unsigned int)B) {
+                        break;
+                    }
+                }
+                continue;
+            }
+        }
+
+        // jumps to the voxel behind the face the ray leaves the box through
+        int axis = 0;
+        float tExit = INF;
+        for (int k = 0; k < 3; k++) {
+            if (!step[k]) {
+                continue;
+            }
+            int steps = step[k] > 0 ? lo[k] + size - voxel[k] : voxel[k] - lo[k] + 1;
+            float tk = tMax[k] + (steps - 1) * tDelta[k];
+            if (tk < tExit) {
+                tExit = tk;
+                axis = k;
+            }
+        }
+        t = tExit;
+        if (t > ray.maxDistance) {
+            return false;
+        }
+        glm::vec3 point = origin + dir * t;
+        for (int k = 0; k < 3; k++) {
+            if (k == axis) {
+                voxel[k] = step[k] > 0 ? lo[k] + size : lo[k] - 1;
+            } else {
+                voxel[k] = std::clamp((int)std::floor(point[k]), lo[k], lo[k] + size - 1);
+            }
+            if (step[k]) {
+                tMax[k] = ((float)(voxel[k] + (step[k] > 0)) - origin[k]) * invDir[k];
+            }
+        }
+        normal = glm::ivec3(0, 0, 0);
+        normal[axis] = -step[axis];
+    }
+    return false;
+}
+
+int Raycaster::cast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, std::vector<uint8_t>& found) {
+    ZoneScopedN("Raycaster::cast");
+    hits.resize(rays.size());
+    found.resize(rays.size());
+    cached_ = false;
+    hasDecoded_ = false;
+    int count = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+        found[i] = castCached(rays[i], hits[i]);
+        count += found[i];
+    }
+    return count;
+}
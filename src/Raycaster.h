@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Block.h"
+#include "ChunkStorage.h"
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction; // doesn't have to be normalized
+    float maxDistance;
+};
+
+struct RaycastHit {
+    Block block;
+    glm::ivec3 position; // of the block that was hit
+    glm::ivec3 normal;   // of the face the ray entered through, zero when it started inside
+    float distance;      // along the normalized direction
+};
+
+/*
+ * Walks rays through the World chunk storage voxel by voxel (Amanatides & Woo)
+ *
+ * Missing chunks and chunks without any solid block are crossed in a single step, so
+ * are the bricks the chunk storage knows to be empty inside the others. The remaining
+ * voxels are read straight from the chunk storage. The last chunk is kept until the
+ * call returns, so the rays of a batch going the same way rarely look chunks up again.
+ * Chunks that aren't in the World but a chunk reader has (see World::setChunkReader)
+ * are decoded into a storage of the raycaster when a ray enters them.
+ *
+ * Nothing is allocated per ray. Raycasters only read the World, so one per thread
+ * can run at the same time as long as nothing modifies it.
+ */
+class Raycaster {
+    glm::ivec3 chunkPos_;
+    const ChunkStorage* chunk_;
+    bool empty_; // the cached chunk is missing or has no solid blocks
+    bool cached_;
+    // the last chunk read through World::readChunk (a compressed one)
+    ChunkStorage decoded_;
+    glm::ivec3 decodedPos_;
+    bool hasDecoded_;
+
+public:
+    Raycaster();
+
+    // finds the first non-air block along the ray
+    bool cast(const Ray& ray, RaycastHit& hit);
+    bool cast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RaycastHit& hit) {
+        return cast(Ray{origin, direction, maxDistance}, hit);
+    }
+    // casts every ray, found is 1 where hits holds a hit, returns the number of hits
+    int cast(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits, std::vector<uint8_t>& found);
+
+private:
+    // the chunk cache has to be reset before, the World may have changed since the last call
+    bool castCached(const Ray& ray, RaycastHit& hit);
+    void lookup(glm::ivec3 chunkPos);
+};
@@ -0,0 +1,110 @@
+#include "RegionFile.h"
+
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ChunkCodec.h"
+#include "tracy/Tracy.hpp"
+
+
+// slots get some room to grow, so a chunk edited a little stays in place
+static constexpr uint32_t SLOT_ALIGNMENT = 256;
+
+std::unique_ptr<RegionFile> RegionFile::open(const std::string& path) {
+    ZoneScopedN("RegionFile::open");
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open region file " << path << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    std::unique_ptr<RegionFile> file(new RegionFile(fd));
+
+    struct stat st;
+    fstat(fd, &st);
+    file->fileSize_ = st.st_size;
+    if (file->fileSize_ == 0) {
+        auto header = std::make_unique<Header>();
+        std::memset(header.get(), 0, sizeof(Header));
+        header->magic = MAGIC;
+        header->version = VERSION;
+        if (pwrite(fd, header.get(), sizeof(Header), 0) != (ssize_t)sizeof(Header)) {
+            std::cerr << "Failed to write region file " << path << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+        file->fileSize_ = sizeof(Header);
+    }
+    if (file->fileSize_ < sizeof(Header)) {
+        std::cerr << "Region file " << path << " is truncated" << std::endl;
+        return nullptr;
+    }
+    auto header = std::make_unique<Header>();
+    if (pread(fd, header.get(), sizeof(Header), 0) != (ssize_t)sizeof(Header)) {
+        std::cerr << "Failed to read region file " << path << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    if (header->magic != MAGIC || header->version != VERSION) {
+        std::cerr << "Region file " << path << " is corrupted or of another version" << std::endl;
+        return nullptr;
+    }
+    file->entries_.assign(header->entries, header->entries + CHUNKS);
+    return file;
+}
+
+RegionFile::RegionFile(int fd) : fd_(fd), fileSize_(0) {
+}
+
+RegionFile::~RegionFile() {
+    close(fd_);
+}
+
+bool RegionFile::save(glm::ivec3 local, const ChunkStorage& chunk) {
+    ZoneScopedN("RegionFile::save");
+    const Entry old = entries_[index(local)];
+    ChunkCodec::encode(chunk, scratch_);
+    Entry entry;
+    entry.size = scratch_.size();
+    auto slot = freeSlots_.lower_bound(entry.size);
+    if (slot != freeSlots_.end()) {
+        entry.capacity = slot->first;
+        entry.offset = slot->second;
+        freeSlots_.erase(slot);
+    } else {
+        entry.offset = fileSize_;
+        entry.capacity = (entry.size + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    }
+
+    // the data goes first, the table points to it only once it's written, a process
+    // dying in between leaves the old chunk (surviving a power loss would need a sync)
+    if (pwrite(fd_, scratch_.data(), entry.size, entry.offset) != (ssize_t)entry.size) {
+        std::cerr << "Failed to write a chunk to a region file: " << std::strerror(errno) << std::endl;
+        // a new slot at the end is taken again by the next save
+        if (entry.offset < fileSize_) {
+            freeSlots_.emplace(entry.capacity, entry.offset);
+        }
+        return false;
+    }
+    // the whole slot belongs to the file, new slots start past its end
+    if ((size_t)entry.offset + entry.capacity > fileSize_) {
+        fileSize_ = (size_t)entry.offset + entry.capacity;
+        if (ftruncate(fd_, fileSize_) != 0) {
+            std::cerr << "Failed to grow a region file: " << std::strerror(errno) << std::endl;
+            freeSlots_.emplace(entry.capacity, entry.offset);
+            return false;
+        }
+    }
+    off_t entryOffset = offsetof(Header, entries) + index(local) * sizeof(Entry);
+    if (pwrite(fd_, &entry, sizeof(Entry), entryOffset) != (ssize_t)sizeof(Entry)) {
+        std::cerr << "Failed to write a region file header: " << std::strerror(errno) << std::endl;
+        freeSlots_.emplace(entry.capacity, entry.offset);
+        return false;
+    }
+    // nothing points to the old slot anymore
+    if (old.offset != 0) {
+        freeSlots_.emplace(old.capacity, old.offset);
+    }
+    entries_[index(local)] = entry;
+    return true;
+}
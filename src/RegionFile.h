@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ChunkStorage.h"
+
+/*
+ * File holding the chunks of a region of SIZE^3 chunks
+ *
+ * The file starts with a header (magic, version and an offset table with an entry per
+ * chunk), the compressed chunks (see ChunkCodec) follow in any order.
+ * Chunks are read straight from the file descriptor (see ChunkIO), only their slot is
+ * read. A saved chunk never overwrites its live slot: it goes to a free slot (or to the
+ * end of the file) and the table entry is switched to it once the data is written, so a
+ * crash leaves either the old or the new chunk. Slots freed that way are reused while
+ * the file stays open, the ones free when it's closed stay unused.
+ */
+class RegionFile {
+public:
+    static constexpr int SIZE = 16;
+    static constexpr int CHUNKS = SIZE*SIZE*SIZE;
+    static constexpr uint32_t MAGIC = 0x47525856; // "VXRG"
+    static constexpr uint32_t VERSION = 2;
+
+    struct Entry {
+        uint32_t offset;   // of the chunk from the start of the file, 0 when it isn't stored
+        uint32_t size;     // of the compressed chunk
+        uint32_t capacity; // of its slot
+    };
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        Entry entries[CHUNKS];
+    };
+
+private:
+    int fd_;
+    std::vector<Entry> entries_; // copy of the header table
+    size_t fileSize_;
+    // capacity -> offset of the slots no entry points to
+    std::multimap<uint32_t, uint32_t> freeSlots_;
+    std::vector<uint8_t> scratch_; // compressed chunk being written
+
+    RegionFile(int fd);
+
+public:
+    // opens the region file or creates an empty one, returns nullptr when it can't
+    static std::unique_ptr<RegionFile> open(const std::string& path);
+    ~RegionFile();
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+
+    // chunk coordinates relative to the region, 0..SIZE-1 on each axis
+    static int index(glm::ivec3 local) {
+        return local.x + local.y*SIZE + local.z*SIZE*SIZE;
+    }
+
+    bool contains(glm::ivec3 local) const { return entries_[index(local)].offset != 0; }
+    const Entry& entry(glm::ivec3 local) const { return entries_[index(local)]; }
+    // for reading the chunks, the file isn't truncated so stored chunks stay valid
+    int fd() const { return fd_; }
+    // writes the chunk, returns false when writing failed
+    bool save(glm::ivec3 local, const ChunkStorage& chunk);
+};
@@ -0,0 +1,74 @@
+#include "RegionStore.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "tracy/Tracy.hpp"
+#include "ChunkCodec.h"
+
+
+RegionStore::RegionStore(const std::string& directory) : directory_(directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        std::cerr << "Failed to create the world directory " << directory_ << ": " << error.message() << std::endl;
+    }
+}
+
+RegionFile* RegionStore::region(glm::ivec3 chunkPos, bool create) {
+    glm::ivec3 regionPos = toRegionPos(chunkPos);
+    auto it = regions_.find(regionPos);
+    if (it != regions_.end()) {
+        return it->second.get();
+    }
+    // looking a chunk up mustn't leave empty files behind
+    if (!create && missing_.contains(regionPos)) {
+        return nullptr;
+    }
+    std::string path = directory_ + "/r." + std::to_string(regionPos.x) + "." + std::to_string(regionPos.y)
+        + "." + std::to_string(regionPos.z) + ".region";
+    if (!create && !std::filesystem::exists(path)) {
+        missing_.insert(regionPos);
+        return nullptr;
+    }
+    std::unique_ptr<RegionFile> file = RegionFile::open(path);
+    if (!file) {
+        return nullptr;
+    }
+    missing_.erase(regionPos);
+    return regions_.emplace(regionPos, std::move(file)).first->second.get();
+}
+
+bool RegionStore::save(glm::ivec3 chunkPos, const ChunkStorage& chunk) {
+    RegionFile* file = region(chunkPos, true);
+    return file && file->save(toLocal(chunkPos), chunk);
+}
+
+bool RegionStore::load(glm::ivec3 chunkPos, ChunkStorage& out) {
+    ZoneScopedN("RegionStore::load");
+    int fd;
+    RegionFile::Entry entry;
+    if (!locate(chunkPos, fd, entry)) {
+        return false;
+    }
+    std::vector<uint8_t> data(entry.size);
+    if (pread(fd, data.data(), entry.size, entry.offset) != (ssize_t)entry.size
+            || !ChunkCodec::decode(data.data(), data.size(), out)) {
+        std::cerr << "Failed to read chunk " << chunkPos.x << " " << chunkPos.y << " " << chunkPos.z << " from its region file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RegionStore::locate(glm::ivec3 chunkPos, int& fd, RegionFile::Entry& entry) {
+    RegionFile* file = region(chunkPos, false);
+    if (!file || !file->contains(toLocal(chunkPos))) {
+        return false;
+    }
+    fd = file->fd();
+    entry = file->entry(toLocal(chunkPos));
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "ChunkStorage.h"
+#include "RegionFile.h"
+
+/*
+ * A saved world, a directory of region files
+ *
+ * Region files are opened the first time one of their chunks is needed and stay open.
+ * Files that failed to open are tried again the next time.
+ */
+class RegionStore {
+    std::string directory_;
+    // region coordinates -> open region file
+    std::unordered_map<glm::ivec3, std::unique_ptr<RegionFile>> regions_;
+    // regions without a file, so lookups of unsaved chunks don't hit the file system
+    std::unordered_set<glm::ivec3> missing_;
+
+public:
+    // creates the directory when it doesn't exist
+    RegionStore(const std::string& directory);
+
+    bool save(glm::ivec3 chunkPos, const ChunkStorage& chunk);
+    // reads the chunk on the calling thread, returns false when it isn't saved or can't be read
+    bool load(glm::ivec3 chunkPos, ChunkStorage& out);
+    // where the compressed chunk lies for reading it asynchronously (see ChunkCodec),
+    // returns false when it isn't saved
+    bool locate(glm::ivec3 chunkPos, int& fd, RegionFile::Entry& entry);
+
+    const std::string& directory() const { return directory_; }
+    int openRegions() const { return regions_.size(); }
+
+    static glm::ivec3 toRegionPos(glm::ivec3 chunkPos) {
+        return {chunkPos.x >> REGION_SHIFT, chunkPos.y >> REGION_SHIFT, chunkPos.z >> REGION_SHIFT};
+    }
+    // chunk coordinates inside of its region
+    static glm::ivec3 toLocal(glm::ivec3 chunkPos) {
+        return chunkPos - toRegionPos(chunkPos) * RegionFile::SIZE;
+    }
+
+private:
+    static constexpr int REGION_SHIFT = 4;
+    static_assert(1 << REGION_SHIFT == RegionFile::SIZE);
+
+    // the region file of the chunk, nullptr when it can't be opened or created
+    RegionFile* region(glm::ivec3 chunkPos, bool create);
+};
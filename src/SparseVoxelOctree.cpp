@@ -0,0 +1,310 @@
+#include "SparseVoxelOctree.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+#include "tracy/Tracy.hpp"
+
+
+static constexpr SparseVoxelOctree::Node AIR = {SparseVoxelOctree::NONE, Consts::BlockIDs::air, 0};
+
+// bit 0 is x, bit 1 is y and bit 2 is z, the same order as the chunk storage
+static int childIndex(glm::ivec3 local, int shift) {
+    return ((local.x >> shift) & 1) | (((local.y >> shift) & 1) << 1) | (((local.z >> shift) & 1) << 2);
+}
+
+SparseVoxelOctree::SparseVoxelOctree(glm::ivec3 origin, int levels)
+    : origin_(origin), levels_(levels), root_(AIR), freeCount_(0)
+{
+    assert(levels >= ChunkStorage::SHIFT && levels < 31);
+}
+
+bool SparseVoxelOctree::contains(glm::ivec3 pos) const {
+    glm::ivec3 local = pos - origin_;
+    // negative coordinates wrap around to huge unsigned ones
+    unsigned int size = this->size();
+    return (unsigned int)local.x < size && (unsigned int)local.y < size && (unsigned int)local.z < size;
+}
+
+bool SparseVoxelOctree::insertChunk(glm::ivec3 chunkPos, const ChunkStorage& chunk) {
+    ZoneScopedN("SparseVoxelOctree::insertChunk");
+    glm::ivec3 pos = chunkPos * Consts::CHUNK_SIZE;
+    if (!contains(pos)) {
+        return false;
+    }
+    Node value;
+    if (chunk.isUniform()) {
+        value = {NONE, chunk.get(0).id, 0};
+    } else {
+        scratch_.resize(Consts::CHUNK_SIZE_POW3);
+        chunk.unpack(scratch_.data());
+        value = build(scratch_.data(), 0, 0, 0, ChunkStorage::SHIFT);
+    }
+    root_ = replace(root_, levels_, pos - origin_, ChunkStorage::SHIFT, value);
+    return true;
+}
+
+bool SparseVoxelOctree::removeChunk(glm::ivec3 chunkPos) {
+    glm::ivec3 pos = chunkPos * Consts::CHUNK_SIZE;
+    if (!contains(pos)) {
+        return false;
+    }
+    root_ = replace(root_, levels_, pos - origin_, ChunkStorage::SHIFT, AIR);
+    return true;
+}
+
+void SparseVoxelOctree::clear() {
+    root_ = AIR;
+    nodes_.clear();
+    for (auto& runs : free_) {
+        runs.clear();
+    }
+    freeCount_ = 0;
+}
+
+Block SparseVoxelOctree::sample(glm::ivec3 pos, int level) const {
+    if (!contains(pos)) {
+        return {Consts::BlockIDs::air};
+    }
+    Node node;
+    find(pos, level, node);
+    return {node.block};
+}
+
+bool SparseVoxelOctree::isOccupied(glm::ivec3 pos, int level) const {
+    if (!contains(pos)) {
+        return false;
+    }
+    Node node;
+    find(pos, level, node);
+    return !node.isEmpty();
+}
+
+int SparseVoxelOctree::find(glm::ivec3 pos, int level, Node& out) const {
+    glm::ivec3 local = pos - origin_;
+    out = root_;
+    int l = levels_;
+    while (l > level && !out.isLeaf()) {
+        l--;
+        out = child(out, childIndex(local, l));
+    }
+    return l;
+}
+
+SparseVoxelOctree::Node SparseVoxelOctree::child(const Node& node, int index) const {
+    if (node.isLeaf()) {
+        return node;
+    }
+    if (!(node.mask & (1 << index))) {
+        return AIR;
+    }
+    return nodes_[node.children + std::popcount((unsigned int)node.mask & ((1u << index) - 1))];
+}
+
+void SparseVoxelOctree::expand(const Node& node, Node (&children)[8]) const {
+    for (int i = 0; i < 8; i++) {
+        children[i] = child(node, i);
+    }
+}
+
+SparseVoxelOctree::Node SparseVoxelOctree::combine(const Node (&children)[8]) {
+    bool uniform = children[0].isLeaf();
+    for (int i = 1; i < 8 && uniform; i++) {
+        uniform = children[i].isLeaf() && children[i].block == children[0].block;
+    }
+    if (uniform) {
+        return children[0];
+    }
+
+    uint8_t mask = 0;
+    for (int i = 0; i < 8; i++) {
+        if (!children[i].isEmpty()) {
+            mask |= 1 << i;
+        }
+    }
+    // the most common block of the children, ties go to the first one
+    uint16_t block = Consts::BlockIDs::air;
+    int best = 0;
+    for (int i = 0; i < 8; i++) {
+        if (!(mask & (1 << i))) {
+            continue;
+        }
+        int count = 0;
+        for (int j = i; j < 8; j++) {
+            count += (mask & (1 << j)) && children[j].block == children[i].block;
+        }
+        if (count > best) {
+            best = count;
+            block = children[i].block;
+        }
+    }
+
+    uint32_t first = allocate(std::popcount(mask));
+    uint32_t at = first;
+    for (int i = 0; i < 8; i++) {
+        if (mask & (1 << i)) {
+            nodes_[at++] = children[i];
+        }
+    }
+    return {first, block, mask};
+}
+
+SparseVoxelOctree::Node SparseVoxelOctree::replace(const Node& node, int level, glm::ivec3 local, int targetLevel, const Node& value) {
+    if (level == targetLevel) {
+        release(node);
+        return value;
+    }
+    Node children[8];
+    expand(node, children);
+    int index = childIndex(local, level - 1);
+    children[index] = replace(children[index], level - 1, local, targetLevel, value);
+    // the children were copied out, only the run holding them goes
+    if (!node.isLeaf()) {
+        free(node.children, std::popcount(node.mask));
+    }
+    return combine(children);
+}
+
+SparseVoxelOctree::Node SparseVoxelOctree::build(const Block* blocks, int x, int y, int z, int level) {
+    if (level == 0) {
+        return {NONE, blocks[ChunkStorage::index(x, y, z)].id, 0};
+    }
+    int half = 1 << (level - 1);
+    Node children[8];
+    for (int i = 0; i < 8; i++) {
+        children[i] = build(blocks, x + (i & 1) * half, y + ((i >> 1) & 1) * half, z + (i >> 2) * half, level - 1);
+    }
+    return combine(children);
+}
+
+void SparseVoxelOctree::release(const Node& node) {
+    if (node.isLeaf()) {
+        return;
+    }
+    int count = std::popcount(node.mask);
+    for (int i = 0; i < count; i++) {
+        release(nodes_[node.children + i]);
+    }
+    free(node.children, count);
+}
+
+uint32_t SparseVoxelOctree::allocate(int count) {
+    std::vector<uint32_t>& runs = free_[count];
+    if (!runs.empty()) {
+        uint32_t first = runs.back();
+        runs.pop_back();
+        freeCount_ -= count;
+        return first;
+    }
+    uint32_t first = nodes_.size();
+    nodes_.resize(first + count);
+    return first;
+}
+
+void SparseVoxelOctree::free(uint32_t first, int count) {
+    free_[count].push_back(first);
+    freeCount_ += count;
+}
+
+bool SparseVoxelOctree::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit& hit, int minLevel) const {
+    ZoneScopedN("SparseVoxelOctree::raycast");
+    float length = glm::length(direction);
+    if (length == 0.0f) {
+        return false;
+    }
+    glm::vec3 lo = glm::vec3(origin_);
+    glm::vec3 hi = lo + glm::vec3((float)size());
+
+    Ray ray;
+    ray.worldOrigin = origin;
+    ray.worldDirection = direction / length;
+    ray.mirrorSum = lo + hi;
+    ray.mirror = 0;
+    for (int k = 0; k < 3; k++) {
+        float d = ray.worldDirection[k];
+        ray.origin[k] = origin[k];
+        if (d < 0.0f) {
+            ray.origin[k] = ray.mirrorSum[k] - origin[k];
+            ray.mirror |= 1 << k;
+            d = -d;
+        }
+        // parallel axes get a huge inverse instead of infinity, 0 * infinity would be nan
+        ray.invDirection[k] = d > 1e-12f ? 1.0f / d : 1e30f;
+    }
+
+    glm::vec3 tLo = (lo - ray.origin) * ray.invDirection;
+    glm::vec3 tHi = (hi - ray.origin) * ray.invDirection;
+    float tEnter = std::max(std::max(tLo.x, tLo.y), std::max(tLo.z, 0.0f));
+    float tExit = std::min(std::min(tHi.x, tHi.y), std::min(tHi.z, maxDistance));
+    if (tEnter > tExit) {
+        return false;
+    }
+    return trace(root_, levels_, lo, tEnter, tExit, ray, minLevel, hit);
+}
+
+bool SparseVoxelOctree::trace(const Node& node, int level, glm::vec3 lo, float tEnter, float tExit,
+        const Ray& ray, int minLevel, RayHit& hit) const {
+    if (node.isEmpty()) {
+        return false;
+    }
+    float size = (float)(1 << level);
+    if (node.isLeaf() || level <= minLevel) {
+        hit.block = {node.block};
+        hit.distance = tEnter;
+        hit.level = level;
+        // the ray entered through the plane it crossed last, none when it started inside
+        glm::vec3 tNear = (lo - ray.origin) * ray.invDirection;
+        int axis = tNear.x >= tNear.y ? (tNear.x >= tNear.z ? 0 : 2) : (tNear.y >= tNear.z ? 1 : 2);
+        hit.normal = glm::ivec3(0);
+        if (tNear[axis] > 0.0f) {
+            hit.normal[axis] = ray.worldDirection[axis] > 0.0f ? -1 : 1;
+        }
+        // the node in world space, the hit block is the one at the entry point
+        glm::vec3 worldLo = lo;
+        for (int k = 0; k < 3; k++) {
+            if (ray.mirror & (1 << k)) {
+                worldLo[k] = ray.mirrorSum[k] - lo[k] - size;
+            }
+        }
+        glm::vec3 point = ray.worldOrigin + ray.worldDirection * tEnter;
+        for (int k = 0; k < 3; k++) {
+            int min = (int)worldLo[k];
+            hit.position[k] = std::clamp((int)std::floor(point[k]), min, min + (1 << level) - 1);
+        }
+        return true;
+    }
+
+    // children are visited front to back, in the mirrored space the index only gains bits
+    float half = size * 0.5f;
+    glm::vec3 tMid = (lo + half - ray.origin) * ray.invDirection;
+    int index = 0;
+    for (int k = 0; k < 3; k++) {
+        if (tMid[k] <= tEnter) {
+            index |= 1 << k;
+        }
+    }
+    float t = tEnter;
+    while (true) {
+        float childExit = tExit;
+        for (int k = 0; k < 3; k++) {
+            if (!(index & (1 << k))) {
+                childExit = std::min(childExit, tMid[k]);
+            }
+        }
+        glm::vec3 childLo = lo + glm::vec3(index & 1, (index >> 1) & 1, index >> 2) * half;
+        if (t < childExit && trace(child(node, index ^ ray.mirror), level - 1, childLo, t, childExit, ray, minLevel, hit)) {
+            return true;
+        }
+        if (childExit >= tExit) {
+            return false;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (!(index & (1 << k)) && tMid[k] <= childExit) {
+                index |= 1 << k;
+            }
+        }
+        t = childExit;
+    }
+}
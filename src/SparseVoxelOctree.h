@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Block.h"
+#include "ChunkStorage.h"
+
+/*
+ * Sparse voxel octree over a cube of 2^levels blocks, built from chunk data
+ *
+ * A node is either a leaf filling its whole cube with one block, or has up to 8 children.
+ * Only the non-air children are stored, next to each other in the node pool, the child
+ * mask says which ones exist and a child is found by counting the set bits below it.
+ * Regions of a single block (air, solid stone) collapse into one leaf at any level.
+ *
+ * Every node also keeps a representative block (the most common one of its children),
+ * so the tree can be sampled at a coarser level of detail for far-field rendering.
+ */
+class SparseVoxelOctree {
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        uint32_t children; // index of the first child in the pool, NONE for leaves
+        uint16_t block;    // the block of a leaf, the representative block of the others
+        uint8_t mask;      // children that aren't air
+
+        bool isLeaf() const { return children == NONE; }
+        bool isEmpty() const { return isLeaf() && block == Consts::BlockIDs::air; }
+    };
+
+    struct RayHit {
+        Block block;
+        glm::ivec3 position; // of the block that was hit
+        glm::ivec3 normal;   // of the face the ray entered through, zero when it started inside
+        float distance;      // along the ray direction
+        int level;           // of the node that was hit
+    };
+
+private:
+    // the ray mirrored so it goes in the positive direction on every axis
+    struct Ray {
+        glm::vec3 origin, invDirection;
+        int mirror; // axes that were flipped, child indices are xored with it
+        glm::vec3 worldOrigin, worldDirection;
+        glm::vec3 mirrorSum; // flips a mirrored coordinate back, lo + hi of the tree
+    };
+
+    glm::ivec3 origin_;
+    int levels_;
+    Node root_;
+    std::vector<Node> nodes_;
+    // freed runs of nodes by their length, reused before the pool grows
+    std::array<std::vector<uint32_t>, 9> free_;
+    size_t freeCount_;
+    std::vector<Block> scratch_; // unpacked chunk being inserted
+
+public:
+    // covers the blocks from origin to origin + 2^levels, levels have to be at least the chunk size
+    SparseVoxelOctree(glm::ivec3 origin, int levels);
+
+    glm::ivec3 origin() const { return origin_; }
+    int levels() const { return levels_; }
+    int size() const { return 1 << levels_; }
+    bool contains(glm::ivec3 pos) const;
+
+    // replaces the blocks of the chunk, returns false when it's outside of the tree
+    bool insertChunk(glm::ivec3 chunkPos, const ChunkStorage& chunk);
+    // fills the chunk with air
+    bool removeChunk(glm::ivec3 chunkPos);
+    void clear();
+
+    Block get(glm::ivec3 pos) const { return sample(pos, 0); }
+    // representative block of the node with the size of 2^level containing the position
+    Block sample(glm::ivec3 pos, int level) const;
+    // whether there are any blocks in the node with the size of 2^level containing the position
+    bool isOccupied(glm::ivec3 pos, int level) const;
+
+    // finds the first non-air block along the ray, nodes at minLevel and above it are
+    // treated as solid cubes of their representative block
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit& hit, int minLevel = 0) const;
+
+    // nodes in use, without the freed ones
+    size_t nodeCount() const { return nodes_.size() - freeCount_; }
+    // bytes taken by the node pool
+    size_t memoryUsage() const { return nodes_.capacity() * sizeof(Node); }
+
+private:
+    // finds the deepest node of at least 2^level containing the position, returns its level
+    int find(glm::ivec3 pos, int level, Node& out) const;
+    Node child(const Node& node, int index) const;
+    // children of the node, air for the missing ones and copies of a leaf for leaves
+    void expand(const Node& node, Node (&children)[8]) const;
+    // makes a node out of the children, collapses them when they're the same leaf
+    Node combine(const Node (&children)[8]);
+    Node replace(const Node& node, int level, glm::ivec3 local, int targetLevel, const Node& value);
+    Node build(const Block* blocks, int x, int y, int z, int level);
+    void release(const Node& node);
+    uint32_t allocate(int count);
+    void free(uint32_t first, int count);
+    bool trace(const Node& node, int level, glm::vec3 lo, float tEnter, float tExit,
+        const Ray& ray, int minLevel, RayHit& hit) const;
+};
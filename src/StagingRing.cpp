@@ -0,0 +1,138 @@
+#include "StagingRing.h"
+
+#include <GL/glew.h>
+
+#include "GLCommon.h"
+#include "tracy/Tracy.hpp"
+
+
+static constexpr uint32_t ALIGNMENT = 64;
+
+StagingRing::StagingRing(uint32_t capacity)
+    : buffer_(0), capacity_(capacity), mapped_(nullptr), firstId_(0), head_(0), inFlight_(0),
+      nextFence_(1), signaledFence_(0), unfenced_(false)
+{
+    if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+        return;
+    }
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLCall(glGenBuffers(1, &buffer_));
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, buffer_));
+    GLCall(glBufferStorage(GL_COPY_READ_BUFFER, capacity_, nullptr, flags));
+    GLCall(mapped_ = (char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity_, flags));
+}
+
+StagingRing::~StagingRing() {
+    for (Fence& fence : fences_) {
+        glDeleteSync((GLsync)fence.sync);
+    }
+    if (buffer_) {
+        if (mapped_) {
+            GLCall(glBindBuffer(GL_COPY_READ_BUFFER, buffer_));
+            GLCall(glUnmapBuffer(GL_COPY_READ_BUFFER));
+        }
+        GLCall(glDeleteBuffers(1, &buffer_));
+    }
+}
+
+size_t StagingRing::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inFlight_;
+}
+
+bool StagingRing::reserve(uint32_t size, Region& out) {
+    if (!mapped_ || size == 0) {
+        return false;
+    }
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t offset;
+    if (regions_.empty()) {
+        offset = 0;
+    } else {
+        uint32_t tail = regions_.front().offset;
+        if (head_ > tail) {
+            // free space after the head and before the tail, a region doesn't wrap
+            if (capacity_ - head_ >= size)
+                offset = head_;
+            else if (tail >= size)
+                offset = 0;
+            else
+                return false;
+        } else {
+            // wrapped around, the free space is between the head and the tail
+            if (tail - head_ >= size)
+                offset = head_;
+            else
+                return false;
+        }
+    }
+    if (offset + size > capacity_) {
+        return false;
+    }
+    out = {firstId_ + regions_.size(), offset, size, mapped_ + offset};
+    regions_.push_back({offset, size, State::reserved, 0});
+    head_ = offset + size;
+    updateInFlight();
+    return true;
+}
+
+void StagingRing::submit(const Region& region) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = regions_[region.id - firstId_];
+    entry.state = State::submitted;
+    entry.fence = nextFence_;
+    unfenced_ = true;
+}
+
+void StagingRing::drop(const Region& region) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_[region.id - firstId_].state = State::dropped;
+}
+
+void StagingRing::fence() {
+    if (!unfenced_) {
+        return;
+    }
+    fences_.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), nextFence_++});
+    unfenced_ = false;
+}
+
+void StagingRing::reclaim() {
+    ZoneScopedN("StagingRing::reclaim");
+    while (!fences_.empty()) {
+        GLenum status = glClientWaitSync((GLsync)fences_.front().sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        signaledFence_ = fences_.front().id;
+        glDeleteSync((GLsync)fences_.front().sync);
+        fences_.pop_front();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!regions_.empty()) {
+        const Entry& entry = regions_.front();
+        bool done = entry.state == State::dropped
+            || (entry.state == State::submitted && entry.fence <= signaledFence_);
+        if (!done) {
+            break;
+        }
+        regions_.pop_front();
+        firstId_++;
+    }
+    if (regions_.empty()) {
+        head_ = 0;
+    }
+    updateInFlight();
+}
+
+void StagingRing::updateInFlight() {
+    if (regions_.empty()) {
+        inFlight_ = 0;
+        return;
+    }
+    // a skipped end of the ring counts until the region before it is reclaimed
+    uint32_t tail = regions_.front().offset;
+    inFlight_ = head_ > tail ? head_ - tail : capacity_ - tail + head_;
+}
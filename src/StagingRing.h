@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+/*
+ * Persistently mapped, coherent upload buffer used as a ring
+ *
+ * Meshing workers reserve a region and write their vertices straight into it, the main
+ * thread only issues the gpu copies out of it (MeshArena::copy). Regions are reclaimed
+ * in ring order once the fence put after their copy has signaled.
+ *
+ * Needs glBufferStorage (OpenGL 4.4 or ARB_buffer_storage), without it every reserve
+ * fails and callers fall back to uploading from their own memory.
+ */
+class StagingRing {
+public:
+    struct Region {
+        uint64_t id;
+        uint32_t offset; // in bytes from the start of the buffer
+        uint32_t size;
+        void* data;      // mapped memory to write to
+    };
+
+private:
+    enum class State { reserved, submitted, dropped };
+    struct Entry {
+        uint32_t offset, size;
+        State state;
+        uint64_t fence; // id of the fence after the copy of submitted regions
+    };
+    struct Fence {
+        void* sync; // GLsync
+        uint64_t id;
+    };
+
+    unsigned int buffer_;
+    uint32_t capacity_;
+    char* mapped_;
+
+    mutable std::mutex mutex_;
+    std::deque<Entry> regions_; // in ring order, the first one starts at the tail
+    uint64_t firstId_;          // id of regions_.front()
+    uint32_t head_;             // where the next region starts
+    size_t inFlight_;           // bytes between the tail and the head
+
+    // main thread only
+    std::deque<Fence> fences_;
+    uint64_t nextFence_, signaledFence_;
+    bool unfenced_; // submitted regions waiting for a fence
+
+    void updateInFlight(); // expects mutex_ to be held
+
+public:
+    StagingRing(uint32_t capacity = 32 << 20);
+    ~StagingRing();
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    bool isSupported() const { return mapped_ != nullptr; }
+    unsigned int buffer() const { return buffer_; }
+    uint32_t capacity() const { return capacity_; }
+    // bytes of regions not reclaimed yet
+    size_t inFlight() const;
+
+    // reserves size bytes, returns false when the ring is full (or unsupported), safe to call from any thread
+    bool reserve(uint32_t size, Region& out);
+
+    // the rest is for the main thread
+    // the region was copied out, it's reclaimed after the next fence signals
+    void submit(const Region& region);
+    // the region won't be used, it's reclaimed as soon as the ones before it are
+    void drop(const Region& region);
+    // puts a fence after the copies of the submitted regions, call once all of them are issued
+    void fence();
+    // frees the regions whose copies have finished
+    void reclaim();
+};
@@ -0,0 +1,141 @@
+#include "TerrainGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tracy/Tracy.hpp"
+
+
+static_assert(Consts::CHUNK_SIZE % Noise::BATCH == 0, "chunk rows are generated in noise batches");
+
+TerrainGenerator::TerrainGenerator(uint32_t seed) : seed_(seed), density_(seed ^ 0xDE45u) {
+    for (int octave = 0; octave < OCTAVES; octave++) {
+        octaves_[octave] = Noise(seed + octave);
+    }
+}
+
+void TerrainGenerator::heights(const float* x, const float* z, int* out) const {
+    float sum[Noise::BATCH] = {};
+    float sampleX[Noise::BATCH], sampleZ[Noise::BATCH], value[Noise::BATCH];
+    float amplitude = 1.0f, frequency = HEIGHT_FREQUENCY, total = 0.0f;
+    for (const Noise& octave : octaves_) {
+        for (int i = 0; i < Noise::BATCH; i++) {
+            sampleX[i] = x[i] * frequency;
+            sampleZ[i] = z[i] * frequency;
+        }
+        octave.simplex2(sampleX, sampleZ, value);
+        for (int i = 0; i < Noise::BATCH; i++) {
+            sum[i] += value[i] * amplitude;
+        }
+        total += amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    for (int i = 0; i < Noise::BATCH; i++) {
+        out[i] = BASE_HEIGHT + (int)std::floor(sum[i] / total * HEIGHT_AMPLITUDE);
+    }
+}
+
+int TerrainGenerator::height(int x, int z) const {
+    float sampleX[Noise::BATCH], sampleZ[Noise::BATCH];
+    int out[Noise::BATCH];
+    std::fill_n(sampleX, Noise::BATCH, (float)x);
+    std::fill_n(sampleZ, Noise::BATCH, (float)z);
+    heights(sampleX, sampleZ, out);
+    return out[0];
+}
+
+void TerrainGenerator::heightmap(glm::ivec3 chunkPos, std::array<int, Consts::CHUNK_SIZE_POW2>& out) const {
+    glm::ivec3 origin = chunkPos * Consts::CHUNK_SIZE;
+    float sampleX[Noise::BATCH], sampleZ[Noise::BATCH];
+    for (int z = 0; z < Consts::CHUNK_SIZE; z++) {
+        std::fill_n(sampleZ, Noise::BATCH, (float)(origin.z + z));
+        for (int x = 0; x < Consts::CHUNK_SIZE; x += Noise::BATCH) {
+            for (int i = 0; i < Noise::BATCH; i++) {
+                sampleX[i] = (float)(origin.x + x + i);
+            }
+            heights(sampleX, sampleZ, &out[x + z * Consts::CHUNK_SIZE]);
+        }
+    }
+}
+
+void TerrainGenerator::generate(glm::ivec3 chunkPos, ChunkStorage& out) const {
+    ZoneScopedN("TerrainGenerator::generate");
+    // the column also covers the layers above the chunk that decide between grass, dirt and stone
+    constexpr int COLUMN = Consts::CHUNK_SIZE + DIRT_DEPTH + 1;
+    constexpr int BATCHES = (2 * DENSITY_AMPLITUDE + Noise::BATCH - 1) / Noise::BATCH;
+    static thread_local std::array<int, Consts::CHUNK_SIZE_POW2> heights;
+    static thread_local std::array<Block, Consts::CHUNK_SIZE_POW3> blocks;
+    const Block air = {Consts::BlockIDs::air};
+    const Block stone = {Consts::BlockIDs::stone};
+    const Block dirt = {Consts::BlockIDs::dirt};
+    const Block grass = {Consts::BlockIDs::grass};
+
+    heightmap(chunkPos, heights);
+    auto [minHeight, maxHeight] = std::minmax_element(heights.begin(), heights.end());
+    int bottom = chunkPos.y * Consts::CHUNK_SIZE;
+    // most chunks are far above or under the surface
+    if (bottom >= *maxHeight + DENSITY_AMPLITUDE) {
+        out.fill(air);
+        return;
+    }
+    if (bottom + COLUMN <= *minHeight - DENSITY_AMPLITUDE) {
+        out.fill(stone);
+        return;
+    }
+
+    bool solid[COLUMN];
+    float sampleX[Noise::BATCH], sampleY[Noise::BATCH], sampleZ[Noise::BATCH], density[Noise::BATCH];
+    for (int z = 0; z < Consts::CHUNK_SIZE; z++) {
+        for (int x = 0; x < Consts::CHUNK_SIZE; x++) {
+            int height = heights[x + z * Consts::CHUNK_SIZE];
+            // the density only matters within its amplitude of the heightmap, solid under and air above
+            int bandStart = height - DENSITY_AMPLITUDE;
+            for (int y = 0; y < COLUMN; y++) {
+                solid[y] = bottom + y < bandStart;
+            }
+            int start = std::max(bandStart, bottom);
+            int end = std::min(height + DENSITY_AMPLITUDE, bottom + COLUMN);
+            if (start < end) {
+                std::fill_n(sampleX, Noise::BATCH, (chunkPos.x * Consts::CHUNK_SIZE + x) * DENSITY_FREQUENCY);
+                std::fill_n(sampleZ, Noise::BATCH, (chunkPos.z * Consts::CHUNK_SIZE + z) * DENSITY_FREQUENCY);
+                for (int batch = 0; batch < BATCHES; batch++) {
+                    int batchStart = bandStart + batch * Noise::BATCH;
+                    if (batchStart >= end || batchStart + Noise::BATCH <= start) {
+                        continue;
+                    }
+                    for (int i = 0; i < Noise::BATCH; i++) {
+                        sampleY[i] = (batchStart + i) * DENSITY_FREQUENCY;
+                    }
+                    density_.simplex3(sampleX, sampleY, sampleZ, density);
+                    for (int i = 0; i < Noise::BATCH; i++) {
+                        int y = batchStart + i;
+                        if (y < start || y >= end) {
+                            continue;
+                        }
+                        float value = std::clamp(density[i], -1.0f, 1.0f);
+                        solid[y - bottom] = (height - y) + value * DENSITY_AMPLITUDE > 0.0f;
+                    }
+                }
+            }
+
+            // counts the solid blocks above, the first one under air is grass
+            int depth = 0;
+            for (int y = COLUMN - 1; y >= 0; y--) {
+                Block block = air;
+                if (!solid[y]) {
+                    depth = 0;
+                } else {
+                    block = depth == 0 ? grass
+                        : depth <= DIRT_DEPTH ? dirt
+                        : stone;
+                    depth++;
+                }
+                if (y < Consts::CHUNK_SIZE) {
+                    blocks[ChunkStorage::index(x, y, z)] = block;
+                }
+            }
+        }
+    }
+    out.assign(blocks.data());
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "ChunkStorage.h"
+#include "Noise.h"
+#include "WorldConstants.h"
+
+/*
+ * Procedural terrain, grass on top of a few layers of dirt over stone
+ *
+ * A 2D noise heightmap gives the rough surface, 3D density noise around it carves
+ * overhangs. Every chunk is a pure function of the seed and its coordinates, so chunks
+ * can be generated on any thread and in any order with the same result.
+ */
+class TerrainGenerator {
+public:
+    static constexpr int BASE_HEIGHT = 24;
+    static constexpr int HEIGHT_AMPLITUDE = 20;
+    static constexpr int DENSITY_AMPLITUDE = 6; // how far the density moves the surface up or down
+    static constexpr int DIRT_DEPTH = 3;        // dirt layers under the grass
+    static constexpr int OCTAVES = 4;
+    static constexpr float HEIGHT_FREQUENCY = 1.0f / 128.0f;
+    static constexpr float DENSITY_FREQUENCY = 1.0f / 24.0f;
+
+private:
+    uint32_t seed_;
+    std::array<Noise, OCTAVES> octaves_;
+    Noise density_;
+
+public:
+    TerrainGenerator(uint32_t seed = Consts::DEFAULT_SEED);
+
+    // fills out with the chunk at chunk coordinates, safe to call from any thread
+    void generate(glm::ivec3 chunkPos, ChunkStorage& out) const;
+    // height of the heightmap (the first air block before the density is applied) at the block position
+    int height(int x, int z) const;
+    uint32_t seed() const { return seed_; }
+
+private:
+    // heights of Noise::BATCH columns
+    void heights(const float* x, const float* z, int* out) const;
+    void heightmap(glm::ivec3 chunkPos, std::array<int, Consts::CHUNK_SIZE_POW2>& out) const;
+};
@@ -0,0 +1,77 @@
+#include "TerrainScheduler.h"
+
+#include "tracy/Tracy.hpp"
+#include "World.h"
+
+
+TerrainScheduler::TerrainScheduler(const TerrainGenerator& generator, ThreadPool& pool)
+    : generator_(generator), pool_(pool), running_(0)
+{
+}
+
+TerrainScheduler::~TerrainScheduler() {
+    // the workers still reference the scheduler
+    while (running_ > 0) {
+        collect(true);
+    }
+}
+
+bool TerrainScheduler::schedule(glm::ivec3 chunkPos) {
+    if (!pending_.insert(chunkPos).second) {
+        return false;
+    }
+    running_++;
+    pool_.submit([this, chunkPos] {
+        Job job = {chunkPos, std::make_unique<ChunkStorage>()};
+        generator_.generate(chunkPos, *job.storage);
+        // notified under the lock, the scheduler may be destroyed as soon as it's released
+        std::lock_guard<std::mutex> lock(completedMutex_);
+        completed_.push_back(std::move(job));
+        completedCond_.notify_one();
+    });
+    return true;
+}
+
+void TerrainScheduler::cancel(glm::ivec3 chunkPos) {
+    pending_.erase(chunkPos);
+}
+
+int TerrainScheduler::insert(std::vector<glm::ivec3>& inserted, int maxInserts) {
+    ZoneScopedN("TerrainScheduler::insert");
+    collect(false);
+    int count = 0;
+    size_t i = 0;
+    for (; i < collected_.size() && count < maxInserts; i++) {
+        Job& job = collected_[i];
+        // cancelled chunks are dropped
+        if (pending_.erase(job.chunkPos)) {
+            World::insertChunk(job.chunkPos, std::move(job.storage));
+            inserted.push_back(job.chunkPos);
+            count++;
+        }
+    }
+    // the rest waits for the next call
+    collected_.erase(collected_.begin(), collected_.begin() + i);
+    return count;
+}
+
+void TerrainScheduler::finish(std::vector<glm::ivec3>& inserted) {
+    ZoneScopedN("TerrainScheduler::finish");
+    insert(inserted);
+    while (running_ > 0) {
+        collect(true);
+        insert(inserted);
+    }
+}
+
+void TerrainScheduler::collect(bool block) {
+    std::unique_lock<std::mutex> lock(completedMutex_);
+    if (block) {
+        completedCond_.wait(lock, [this] { return !completed_.empty(); });
+    }
+    running_ -= completed_.size();
+    for (Job& job : completed_) {
+        collected_.push_back(std::move(job));
+    }
+    completed_.clear();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "ChunkStorage.h"
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+
+/*
+ * Generates chunks on the thread pool
+ *
+ * Workers write into standalone storages, the main thread moves the finished ones
+ * into the World. Generation is deterministic, so a chunk cancelled and scheduled
+ * again can safely take whichever result arrives first.
+ */
+class TerrainScheduler {
+    struct Job {
+        glm::ivec3 chunkPos;
+        std::unique_ptr<ChunkStorage> storage;
+    };
+
+    const TerrainGenerator& generator_;
+    ThreadPool& pool_;
+    // scheduled and not inserted yet
+    std::unordered_set<glm::ivec3> pending_;
+    int running_; // jobs handed to the pool and not collected yet
+
+    std::mutex completedMutex_;
+    std::condition_variable completedCond_;
+    std::vector<Job> completed_;
+    std::vector<Job> collected_; // main thread copy of completed_
+
+public:
+    TerrainScheduler(const TerrainGenerator& generator, ThreadPool& pool = ThreadPool::instance());
+    ~TerrainScheduler();
+
+    // queues the chunk for generation, returns false if it is already queued
+    bool schedule(glm::ivec3 chunkPos);
+    // the chunk won't be inserted into the world when it's done
+    void cancel(glm::ivec3 chunkPos);
+    void cancelAll() { pending_.clear(); }
+    // moves at most maxInserts finished chunks into the World and appends their positions to inserted
+    int insert(std::vector<glm::ivec3>& inserted, int maxInserts = INT_MAX);
+    // blocks until every scheduled chunk has been generated and inserted
+    void finish(std::vector<glm::ivec3>& inserted);
+
+    bool isPending(glm::ivec3 chunkPos) const { return pending_.contains(chunkPos); }
+    int pending() const { return pending_.size(); }
+    const TerrainGenerator& generator() const { return generator_; }
+
+private:
+    void collect(bool block);
+};
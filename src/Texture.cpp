@@ -30,3 +30,51 @@ void Texture::bind(unsigned int slot) {
     GLCall(glActiveTexture(GL_TEXTURE0+slot));
     glBindTexture(GL_TEXTURE_2D, ID);
 }
+
+TextureArray::TextureArray(const char* const* paths, int count, int format)
+    : width_(0), height_(0), layers_(count)
+{
+    GLCall(glGenTextures(1, &ID));
+    GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, ID));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    int channels = format == GL_RGBA ? 4 : 3;
+    for (int i = 0; i < count; i++) {
+        int width, height, nrChannels;
+        unsigned char* data = stbi_load(paths[i], &width, &height, &nrChannels, channels);
+        if (!data) {
+            std::cerr << "Failed to load texture " << paths[i] << std::endl;
+            continue;
+        }
+        if (width_ == 0) {
+            width_ = width;
+            height_ = height;
+            GLCall(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, width_, height_, layers_, 0, format, GL_UNSIGNED_BYTE, NULL));
+        }
+        if (width != width_ || height != height_) {
+            std::cerr << "Texture " << paths[i] << " doesn't match the size of the array" << std::endl;
+        } else {
+            GLCall(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, format, GL_UNSIGNED_BYTE, data));
+        }
+        stbi_image_free(data);
+    }
+    // no layer loaded so nothing was allocated, mipmaps of an incomplete texture are an error
+    if (width_ == 0) {
+        std::cerr << "Failed to load every texture of the array" << std::endl;
+        return;
+    }
+    GLCall(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+}
+
+TextureArray::~TextureArray() {
+    GLCall(glDeleteTextures(1, &ID));
+}
+
+void TextureArray::bind(unsigned int slot) {
+    GLCall(glActiveTexture(GL_TEXTURE0+slot));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+}
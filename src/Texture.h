@@ -10,3 +10,15 @@ public:
     ~Texture();
     void bind(unsigned int slot);
 };
+
+// 2D texture array, all of the images have to be of the same size
+class TextureArray {
+public:
+    unsigned int ID;
+private:
+    int width_, height_, layers_;
+public:
+    TextureArray(const char* const* paths, int count, int format);
+    ~TextureArray();
+    void bind(unsigned int slot);
+};
@@ -0,0 +1,105 @@
+#include "ThreadPool.h"
+
+#include "tracy/Tracy.hpp"
+
+
+// index of the queue of the current worker, -1 on other threads
+static thread_local int t_workerIndex = -1;
+
+ThreadPool::ThreadPool(unsigned int threads)
+    : queued_(0), unfinished_(0), next_(0), stopping_(false)
+{
+    if (threads == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threads = hardware > 1 ? hardware - 1 : 1;
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        threads_.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Job job) {
+    unsigned int index = t_workerIndex >= 0 ? t_workerIndex : next_++ % queues_.size();
+    unfinished_++;
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->jobs.push_back(std::move(job));
+    }
+    {
+        // counted under the lock so a worker going to sleep can't miss it
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_++;
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+bool ThreadPool::pop(unsigned int index, Job& job) {
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (unsigned int i = 1; i < queues_.size(); i++) {
+        Queue& other = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty()) {
+            job = std::move(other.jobs.front());
+            other.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(unsigned int index) {
+    t_workerIndex = index;
+    Job job;
+    while (true) {
+        if (pop(index, job)) {
+            queued_--;
+            {
+                ZoneScopedN("ThreadPool::job");
+                job();
+            }
+            job = nullptr;
+            if (--unfinished_ == 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                idle_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0) {
+            return;
+        }
+    }
+}
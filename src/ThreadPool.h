@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work stealing thread pool
+ *
+ * Every worker owns a queue, jobs submitted from a worker go to its own queue,
+ * others are spread round robin. A worker runs its newest job first and when it
+ * runs out it steals the oldest jobs of the others.
+ */
+class ThreadPool {
+public:
+    using Job = std::function<void()>;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_, idle_;
+    std::atomic<int> queued_;     // submitted and not picked up by a worker yet
+    std::atomic<int> unfinished_; // submitted and not finished yet
+    std::atomic<unsigned int> next_;
+    bool stopping_;
+
+public:
+    // threads = 0 leaves one hardware thread for the main (rendering) thread
+    ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Job job);
+    // blocks until every submitted job has finished
+    void wait();
+    unsigned int size() const { return threads_.size(); }
+
+    // the pool shared by the world systems
+    static ThreadPool& instance();
+
+private:
+    void work(unsigned int index);
+    bool pop(unsigned int index, Job& job);
+};
@@ -0,0 +1,166 @@
+#include "World.h"
+
+#include "tracy/Tracy.hpp"
+#include "ChunkSnapshot.h"
+#include "WorldConstants.h"
+
+
+std::unordered_map<glm::ivec3, std::unique_ptr<ChunkStorage>> World::chunks_;
+glm::ivec3 World::cachedPos_ = {0, 0, 0};
+ChunkStorage* World::cachedChunk_ = nullptr;
+std::unordered_set<glm::ivec3> World::modified_;
+std::unordered_set<glm::ivec3> World::dirty_;
+glm::ivec3 World::lastDirty_ = {0, 0, 0};
+bool World::hasLastDirty_ = false;
+World::ChunkSource World::source_;
+World::ChunkReader World::reader_;
+
+static const Block AIR = {Consts::BlockIDs::air};
+// voxels of a chunk the meshes of its neighbours see, a padding voxel at a level of
+// detail is downsampled from 2^lod of them
+static const int BORDER = 1 << ChunkSnapshot::MAX_LOD;
+
+
+ChunkStorage* World::getChunk(glm::ivec3 chunkPos) {
+    if (cachedChunk_ && cachedPos_ == chunkPos) {
+        return cachedChunk_;
+    }
+    auto it = chunks_.find(chunkPos);
+    if (it == chunks_.end()) {
+        return nullptr;
+    }
+    cachedPos_ = chunkPos;
+    cachedChunk_ = it->second.get();
+    return cachedChunk_;
+}
+
+const ChunkStorage* World::findChunk(glm::ivec3 chunkPos) {
+    auto it = chunks_.find(chunkPos);
+    return it == chunks_.end() ? nullptr : it->second.get();
+}
+
+ChunkStorage* World::getEditableChunk(glm::ivec3 chunkPos) {
+    ChunkStorage* chunk = getChunk(chunkPos);
+    if (!chunk && source_) {
+        chunk = source_(chunkPos);
+    }
+    return chunk;
+}
+
+ChunkStorage& World::getOrCreateChunk(glm::ivec3 chunkPos) {
+    ChunkStorage* chunk = getEditableChunk(chunkPos);
+    if (chunk) {
+        return *chunk;
+    }
+    ZoneScopedN("World::createChunk");
+    auto& slot = chunks_[chunkPos];
+    slot = std::make_unique<ChunkStorage>();
+    cachedPos_ = chunkPos;
+    cachedChunk_ = slot.get();
+    return *slot;
+}
+
+ChunkStorage& World::insertChunk(glm::ivec3 chunkPos, std::unique_ptr<ChunkStorage> chunk) {
+    auto& slot = chunks_[chunkPos];
+    slot = std::move(chunk);
+    cachedPos_ = chunkPos;
+    cachedChunk_ = slot.get();
+    return *slot;
+}
+
+void World::removeChunk(glm::ivec3 chunkPos) {
+    if (cachedChunk_ && cachedPos_ == chunkPos) {
+        cachedChunk_ = nullptr;
+    }
+    chunks_.erase(chunkPos);
+}
+
+Block World::getBlock(int x, int y, int z) {
+    const ChunkStorage* chunk = getChunk(toChunkPos(x, y, z));
+    if (!chunk) {
+        return AIR;
+    }
+    return chunk->get(x & ChunkStorage::MASK, y & ChunkStorage::MASK, z & ChunkStorage::MASK);
+}
+
+Block World::getBlock(glm::vec3 pos) {
+    glm::ivec3 p = glm::ivec3(glm::floor(pos));
+    return getBlock(p.x, p.y, p.z);
+}
+
+Block World::setBlock(int x, int y, int z, Block block) {
+    ChunkStorage& chunk = getOrCreateChunk(toChunkPos(x, y, z));
+    int idx = ChunkStorage::index(x & ChunkStorage::MASK, y & ChunkStorage::MASK, z & ChunkStorage::MASK);
+    Block oldBlock = chunk.get(idx);
+    if (!(oldBlock == block)) {
+        chunk.set(idx, block);
+        markDirty(x, y, z);
+    }
+    return oldBlock;
+}
+
+Block World::setBlock(glm::vec3 pos, Block block) {
+    glm::ivec3 p = glm::ivec3(glm::floor(pos));
+    return setBlock(p.x, p.y, p.z, block);
+}
+
+Block World::removeBlock(int x, int y, int z) {
+    ChunkStorage* chunk = getEditableChunk(toChunkPos(x, y, z));
+    if (!chunk) {
+        return AIR;
+    }
+    int idx = ChunkStorage::index(x & ChunkStorage::MASK, y & ChunkStorage::MASK, z & ChunkStorage::MASK);
+    Block oldBlock = chunk->get(idx);
+    if (!(oldBlock == AIR)) {
+        chunk->set(idx, AIR);
+        markDirty(x, y, z);
+    }
+    return oldBlock;
+}
+
+void World::markDirty(glm::ivec3 min, glm::ivec3 max) {
+    glm::ivec3 from = toChunkPos(min), to = toChunkPos(max);
+    for (int z = from.z; z <= to.z; z++) {
+        for (int y = from.y; y <= to.y; y++) {
+            for (int x = from.x; x <= to.x; x++) {
+                modified_.insert({x, y, z});
+            }
+        }
+    }
+    from = toChunkPos(min - BORDER);
+    to = toChunkPos(max + BORDER);
+    for (int z = from.z; z <= to.z; z++) {
+        for (int y = from.y; y <= to.y; y++) {
+            for (int x = from.x; x <= to.x; x++) {
+                dirty_.insert({x, y, z});
+            }
+        }
+    }
+}
+
+void World::markDirty(int x, int y, int z) {
+    // edits away from the border only touch their own chunk, consecutive ones mostly the same one
+    const unsigned int INNER = Consts::CHUNK_SIZE - 2 * BORDER;
+    bool inner = (unsigned int)((x & ChunkStorage::MASK) - BORDER) < INNER && (unsigned int)((y & ChunkStorage::MASK) - BORDER) < INNER
+        && (unsigned int)((z & ChunkStorage::MASK) - BORDER) < INNER;
+    if (!inner) {
+        markDirty(glm::ivec3(x, y, z), glm::ivec3(x, y, z));
+        return;
+    }
+    glm::ivec3 chunkPos = toChunkPos(x, y, z);
+    if (hasLastDirty_ && lastDirty_ == chunkPos) {
+        return;
+    }
+    modified_.insert(chunkPos);
+    dirty_.insert(chunkPos);
+    lastDirty_ = chunkPos;
+    hasLastDirty_ = true;
+}
+
+void World::takeDirty(std::vector<glm::ivec3>& modified, std::vector<glm::ivec3>& dirty) {
+    modified.assign(modified_.begin(), modified_.end());
+    dirty.assign(dirty_.begin(), dirty_.end());
+    modified_.clear();
+    dirty_.clear();
+    hasLastDirty_ = false;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "Block.h"
+#include "ChunkStorage.h"
+
+
+class World {
+public:
+    // brings back a chunk kept outside of the World, returns nullptr when there's none
+    using ChunkSource = std::function<ChunkStorage*(glm::ivec3 chunkPos)>;
+    // copies a chunk kept outside of the World into out without bringing it back,
+    // returns false when there's none
+    using ChunkReader = std::function<bool(glm::ivec3 chunkPos, ChunkStorage& out)>;
+
+private:
+    // chunk coordinates (block position / CHUNK_SIZE) -> voxel storage
+    static std::unordered_map<glm::ivec3, std::unique_ptr<ChunkStorage>> chunks_;
+    // the last looked up chunk, consecutive accesses mostly hit the same chunk
+    static glm::ivec3 cachedPos_;
+    static ChunkStorage* cachedChunk_;
+    // chunks whose blocks changed and chunks whose mesh is outdated since the last takeDirty
+    static std::unordered_set<glm::ivec3> modified_;
+    static std::unordered_set<glm::ivec3> dirty_;
+    // the chunk of the last edit away from its border, it's in both sets already
+    static glm::ivec3 lastDirty_;
+    static bool hasLastDirty_;
+    static ChunkSource source_;
+    static ChunkReader reader_;
+public:
+    World() {}
+
+    static Block getBlock(int x, int y, int z);
+    static Block getBlock(glm::vec3 pos);
+    static Block setBlock(int x, int y, int z, Block block);
+    static Block setBlock(glm::vec3 pos, Block block);
+    static Block removeBlock(int x, int y, int z);
+
+    // returns the storage of chunk at chunk coordinates or nullptr if it doesn't exist
+    static ChunkStorage* getChunk(glm::ivec3 chunkPos);
+    // same as getChunk without touching the lookup cache, safe to call from several threads while nothing modifies the World
+    static const ChunkStorage* findChunk(glm::ivec3 chunkPos);
+    // the chunk an edit writes into: an existing one or one the chunk source brings back,
+    // nullptr if neither has it
+    static ChunkStorage* getEditableChunk(glm::ivec3 chunkPos);
+    // same as getEditableChunk, creates an empty one if there's none
+    static ChunkStorage& getOrCreateChunk(glm::ivec3 chunkPos);
+    // puts a chunk generated outside of the world in place, replacing the existing one
+    static ChunkStorage& insertChunk(glm::ivec3 chunkPos, std::unique_ptr<ChunkStorage> chunk);
+    static void removeChunk(glm::ivec3 chunkPos);
+    // asked for missing chunks before an edit, so edits don't land in an empty chunk
+    // that would replace the real one later (an empty source clears it)
+    static void setChunkSource(ChunkSource source) { source_ = std::move(source); }
+    // reads of chunks that aren't in the World, so readers see the same blocks as edits
+    // (an empty reader clears it)
+    static void setChunkReader(ChunkReader reader) { reader_ = std::move(reader); }
+    // copies a chunk the reader has into out, false if it has none, safe to call from
+    // several threads while nothing modifies the World
+    static bool readChunk(glm::ivec3 chunkPos, ChunkStorage& out) { return reader_ && reader_(chunkPos, out); }
+
+    // marks the chunks of the blocks in the box (min and max included) modified and every
+    // chunk whose mesh sees one of them dirty, the meshes include the voxels of the
+    // neighbours up to 2^ChunkSnapshot::MAX_LOD deep (one downsampled padding voxel)
+    static void markDirty(glm::ivec3 min, glm::ivec3 max);
+    static void markDirty(int x, int y, int z);
+    // moves the chunks marked since the last call to the vectors, each one is there once
+    static void takeDirty(std::vector<glm::ivec3>& modified, std::vector<glm::ivec3>& dirty);
+
+    // converts block position to the position of the chunk containing it
+    static glm::ivec3 toChunkPos(int x, int y, int z) {
+        return {x >> ChunkStorage::SHIFT, y >> ChunkStorage::SHIFT, z >> ChunkStorage::SHIFT};
+    }
+    static glm::ivec3 toChunkPos(glm::ivec3 pos) { return toChunkPos(pos.x, pos.y, pos.z); }
+};
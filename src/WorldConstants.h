@@ -1,6 +1,9 @@
+#pragma once
+
 namespace Consts {
-    const int VIEW_DISTANCE = 2; // radius of the view distance
+    const int VIEW_DISTANCE = 6; // radius of the view distance in chunks
     const int FULL_VIEW_DISTANCE = VIEW_DISTANCE*2+1; // diameter of the view distance
+    const int LOD_DISTANCE = 3; // chunks closer than this are meshed at full detail, every next level of detail starts twice as far
 
     const int CHUNK_SIZE = 32; // size of chunk side
     const int CHUNK_SIZE_POW2 = CHUNK_SIZE*CHUNK_SIZE; // 2nd power of chunk side
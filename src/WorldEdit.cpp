@@ -0,0 +1,261 @@
+#include "WorldEdit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "tracy/Tracy.hpp"
+#include "World.h"
+#include "WorldConstants.h"
+
+
+static const Block AIR = {Consts::BlockIDs::air};
+static constexpr int S = Consts::CHUNK_SIZE;
+
+// a whole chunk of blocks, every thread reuses its own
+static Block* scratch() {
+    static thread_local std::vector<Block> blocks(Consts::CHUNK_SIZE_POW3);
+    return blocks.data();
+}
+
+// calls edit(chunkPos, from, to) for every chunk the box overlaps, from and to bound the part
+// of the box inside of the chunk (in chunk local coordinates, both included), the chunks the
+// edit returns true for are marked dirty
+template <typename Edit>
+static int forEachChunk(glm::ivec3 min, glm::ivec3 max, Edit edit) {
+    glm::ivec3 first = World::toChunkPos(min), last = World::toChunkPos(max);
+    int touched = 0;
+    for (int cz = first.z; cz <= last.z; cz++) {
+        for (int cy = first.y; cy <= last.y; cy++) {
+            for (int cx = first.x; cx <= last.x; cx++) {
+                glm::ivec3 chunkPos(cx, cy, cz);
+                glm::ivec3 base = chunkPos * S;
+                glm::ivec3 from, to;
+                for (int k = 0; k < 3; k++) {
+                    from[k] = std::max(min[k] - base[k], 0);
+                    to[k] = std::min(max[k] - base[k], S - 1);
+                }
+                if (edit(chunkPos, from, to)) {
+                    World::markDirty(base + from, base + to);
+                    touched++;
+                }
+            }
+        }
+    }
+    return touched;
+}
+
+static bool coversChunk(glm::ivec3 from, glm::ivec3 to) {
+    return from == glm::ivec3(0) && to == glm::ivec3(S - 1);
+}
+
+// true when writing only block into the chunk can't change it, a missing chunk is all air
+static bool unchanged(const ChunkStorage* chunk, Block block) {
+    if (!chunk) {
+        return block == AIR;
+    }
+    return chunk->isUniform() && chunk->get(0) == block;
+}
+
+// the blocks of the chunk in the scratch, all air for a missing one
+static Block* unpack(const ChunkStorage* chunk) {
+    Block* blocks = scratch();
+    if (chunk) {
+        chunk->unpack(blocks);
+    } else {
+        std::fill_n(blocks, Consts::CHUNK_SIZE_POW3, AIR);
+    }
+    return blocks;
+}
+
+// packs the blocks into the chunk, a missing one is created only now that something is written
+static void store(glm::ivec3 chunkPos, ChunkStorage* chunk, const Block* blocks) {
+    (chunk ? *chunk : World::getOrCreateChunk(chunkPos)).assign(blocks);
+}
+
+int WorldEdit::fill(glm::ivec3 min, glm::ivec3 max, Block block) {
+    ZoneScopedN("WorldEdit::fill");
+    return forEachChunk(min, max, [block](glm::ivec3 chunkPos, glm::ivec3 from, glm::ivec3 to) {
+        ChunkStorage* chunk = World::getEditableChunk(chunkPos);
+        if (unchanged(chunk, block)) {
+            return false;
+        }
+        if (coversChunk(from, to)) {
+            (chunk ? *chunk : World::getOrCreateChunk(chunkPos)).fill(block);
+            return true;
+        }
+        Block* blocks = unpack(chunk);
+        const int length = to.x - from.x + 1;
+        for (int z = from.z; z <= to.z; z++) {
+            for (int y = from.y; y <= to.y; y++) {
+                std::fill_n(blocks + ChunkStorage::index(from.x, y, z), length, block);
+            }
+        }
+        store(chunkPos, chunk, blocks);
+        return true;
+    });
+}
+
+int WorldEdit::fillEllipsoid(glm::vec3 center, glm::vec3 radii, Block block) {
+    ZoneScopedN("WorldEdit::fillEllipsoid");
+    if (radii.x <= 0.0f || radii.y <= 0.0f || radii.z <= 0.0f) {
+        return 0;
+    }
+    // the blocks whose centers can be inside
+    glm::ivec3 min, max;
+    for (int k = 0; k < 3; k++) {
+        min[k] = (int)std::ceil(center[k] - radii[k] - 0.5f);
+        max[k] = (int)std::floor(center[k] + radii[k] - 0.5f);
+    }
+    const glm::vec3 inverse = 1.0f / radii;
+    auto inside = [center, inverse](glm::ivec3 pos) {
+        glm::vec3 d = (glm::vec3(pos) + 0.5f - center) * inverse;
+        return d.x*d.x + d.y*d.y + d.z*d.z <= 1.0f;
+    };
+
+    return forEachChunk(min, max, [&](glm::ivec3 chunkPos, glm::ivec3 from, glm::ivec3 to) {
+        ChunkStorage* chunk = World::getEditableChunk(chunkPos);
+        if (unchanged(chunk, block)) {
+            return false;
+        }
+        const glm::ivec3 base = chunkPos * S;
+        // the ellipsoid is convex, a chunk with all its corners inside is inside whole
+        if (coversChunk(from, to)) {
+            bool whole = true;
+            for (int i = 0; i < 8 && whole; i++) {
+                whole = inside(base + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2) * (S - 1));
+            }
+            if (whole) {
+                (chunk ? *chunk : World::getOrCreateChunk(chunkPos)).fill(block);
+                return true;
+            }
+        }
+
+        Block* blocks = unpack(chunk);
+        bool changed = false;
+        for (int z = from.z; z <= to.z; z++) {
+            float dz = ((float)(base.z + z) + 0.5f - center.z) * inverse.z;
+            for (int y = from.y; y <= to.y; y++) {
+                float dy = ((float)(base.y + y) + 0.5f - center.y) * inverse.y;
+                float rest = 1.0f - dy*dy - dz*dz;
+                if (rest < 0.0f) {
+                    continue;
+                }
+                // the row of block centers within half of the chord
+                float half = std::sqrt(rest) * radii.x;
+                int x0 = std::max((int)std::ceil(center.x - half - 0.5f) - base.x, from.x);
+                int x1 = std::min((int)std::floor(center.x + half - 0.5f) - base.x, to.x);
+                if (x0 <= x1) {
+                    std::fill_n(blocks + ChunkStorage::index(x0, y, z), x1 - x0 + 1, block);
+                    changed = true;
+                }
+            }
+        }
+        // the corners of the bounding box often miss the ellipsoid
+        if (changed) {
+            store(chunkPos, chunk, blocks);
+        }
+        return changed;
+    });
+}
+
+void WorldEdit::copy(glm::ivec3 min, glm::ivec3 max, Clipboard& out) {
+    ZoneScopedN("WorldEdit::copy");
+    out.size = max - min + 1;
+    if (out.size.x <= 0 || out.size.y <= 0 || out.size.z <= 0) {
+        out.size = glm::ivec3(0);
+        out.blocks.clear();
+        return;
+    }
+    out.blocks.assign((size_t)out.size.x * out.size.y * out.size.z, AIR);
+    forEachChunk(min, max, [&out, min](glm::ivec3 chunkPos, glm::ivec3 from, glm::ivec3 to) {
+        // chunks kept outside of the World (compressed ones) are decoded into a copy
+        static thread_local ChunkStorage decoded;
+        const ChunkStorage* chunk = World::getChunk(chunkPos);
+        if (!chunk && World::readChunk(chunkPos, decoded)) {
+            chunk = &decoded;
+        }
+        if (!chunk) {
+            return false;
+        }
+        // clipboard coordinates of the chunk origin
+        const glm::ivec3 base = chunkPos * S - min;
+        const int length = to.x - from.x + 1;
+        const Block* blocks = nullptr;
+        if (!chunk->isUniform()) {
+            Block* unpacked = scratch();
+            chunk->unpack(unpacked);
+            blocks = unpacked;
+        }
+        for (int z = from.z; z <= to.z; z++) {
+            for (int y = from.y; y <= to.y; y++) {
+                Block* row = &out.blocks[(base.x + from.x) + out.size.x * ((base.y + y) + out.size.y * (size_t)(base.z + z))];
+                if (blocks) {
+                    std::memcpy(row, blocks + ChunkStorage::index(from.x, y, z), length * sizeof(Block));
+                } else {
+                    std::fill_n(row, length, chunk->get(0));
+                }
+            }
+        }
+        // reading doesn't make the chunk dirty
+        return false;
+    });
+}
+
+glm::ivec3 WorldEdit::turnedSize(glm::ivec3 size, int quarterTurns) {
+    return (quarterTurns & 1) ? glm::ivec3(size.z, size.y, size.x) : size;
+}
+
+int WorldEdit::paste(const Clipboard& clipboard, glm::ivec3 origin, int quarterTurns, bool skipAir) {
+    ZoneScopedN("WorldEdit::paste");
+    const glm::ivec3 source = clipboard.size;
+    if (source.x <= 0 || source.y <= 0 || source.z <= 0) {
+        return 0;
+    }
+    const int turns = ((quarterTurns % 4) + 4) % 4;
+    const glm::ivec3 size = turnedSize(source, turns);
+
+    return forEachChunk(origin, origin + size - 1, [&](glm::ivec3 chunkPos, glm::ivec3 from, glm::ivec3 to) {
+        ChunkStorage* chunk = World::getEditableChunk(chunkPos);
+        Block* blocks = scratch();
+        // a chunk overwritten whole doesn't need its old blocks
+        if (skipAir || !coversChunk(from, to)) {
+            blocks = unpack(chunk);
+        }
+        // coordinates in the pasted box of the chunk origin
+        const glm::ivec3 base = chunkPos * S - origin;
+        const int length = to.x - from.x + 1;
+        for (int z = from.z; z <= to.z; z++) {
+            const int w = base.z + z;
+            for (int y = from.y; y <= to.y; y++) {
+                const int v = base.y + y;
+                Block* row = blocks + ChunkStorage::index(from.x, y, z);
+                if (turns == 0 && !skipAir) {
+                    std::memcpy(row, &clipboard.blocks[(base.x + from.x) + source.x * (v + source.y * (size_t)w)], length * sizeof(Block));
+                    continue;
+                }
+                for (int i = 0; i < length; i++) {
+                    const int u = base.x + from.x + i;
+                    // the block of the unturned clipboard that ends up at (u, w)
+                    int x, z;
+                    switch (turns) {
+                    case 0: x = u; z = w; break;
+                    case 1: x = w; z = source.z - 1 - u; break;
+                    case 2: x = source.x - 1 - u; z = source.z - 1 - w; break;
+                    default: x = source.x - 1 - w; z = u; break;
+                    }
+                    Block block = clipboard.get(x, v, z);
+                    if (!skipAir || !(block == AIR)) {
+                        row[i] = block;
+                    }
+                }
+            }
+        }
+        // pasting only air where there's no chunk leaves it missing
+        if (!chunk && std::all_of(blocks, blocks + Consts::CHUNK_SIZE_POW3, [](Block b) { return b == AIR; })) {
+            return false;
+        }
+        store(chunkPos, chunk, blocks);
+        return true;
+    });
+}
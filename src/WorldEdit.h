@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Block.h"
+#include "ChunkStorage.h"
+
+// blocks of a box copied out of the World, x is the fastest varying axis, then y, then z
+struct Clipboard {
+    glm::ivec3 size = {0, 0, 0};
+    std::vector<Block> blocks;
+
+    Block get(int x, int y, int z) const { return blocks[x + size.x * (y + size.y * z)]; }
+};
+
+/*
+ * Bulk edits of the World
+ *
+ * Edits go chunk by chunk instead of block by block: chunks covered whole switch to a
+ * single block, the others are unpacked once, written a row at a time (std::fill and
+ * memcpy) and packed again. Every touched chunk is marked dirty once (see World::markDirty).
+ *
+ * Boxes are given by their min and max blocks, both included. Chunks that don't exist
+ * are created once a block other than air is written into them, the corners of a
+ * sphere's bounding box don't leave empty chunks behind.
+ *
+ * Edits are meant for the chunks a ChunkManager streams. A chunk created outside of
+ * them holds only the edited blocks: the manager doesn't save or unload it, and it's
+ * replaced when that chunk is streamed in later.
+ */
+class WorldEdit {
+public:
+    // sets every block of the box, returns the number of chunks touched
+    static int fill(glm::ivec3 min, glm::ivec3 max, Block block);
+    // sets the blocks whose centers lie inside of the ellipsoid, air carves it out
+    static int fillEllipsoid(glm::vec3 center, glm::vec3 radii, Block block);
+    static int fillSphere(glm::vec3 center, float radius, Block block) {
+        return fillEllipsoid(center, glm::vec3(radius), block);
+    }
+
+    // copies the box into out, missing chunks read as air
+    static void copy(glm::ivec3 min, glm::ivec3 max, Clipboard& out);
+    // places the clipboard with its min corner at origin after turning it by quarterTurns
+    // around the y axis (each turn maps +x to +z and +z to -x), with skipAir the air
+    // of the clipboard leaves the World blocks in place, returns the number of chunks touched
+    static int paste(const Clipboard& clipboard, glm::ivec3 origin, int quarterTurns = 0, bool skipAir = false);
+    // size of the box the clipboard covers once turned
+    static glm::ivec3 turnedSize(glm::ivec3 size, int quarterTurns);
+};
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <memory>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -12,7 +14,14 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "Texture.h"
-#include "Chunk.h"
+#include "BlockRegistry.h"
+#include "ChunkCodec.h"
+#include "ChunkManager.h"
+#include "Noise.h"
+#include "QuadIndexBuffer.h"
+#include "Raycaster.h"
+#include "World.h"
+#include "WorldEdit.h"
 #include "WorldConstants.h"
 
 #include "tracy/Tracy.hpp"
@@ -26,7 +35,9 @@ static struct State {
     Camera* cam;
     bool drawLines = false;
     bool cullFaces = true;
+    bool cullFrustum = true;
     bool shouldWindowClose = false;
+    MeshingMode meshingMode = MeshingMode::greedy;
 } s_state;
 
 // glfw callbacks
@@ -42,7 +53,166 @@ void changeDrawMode() {
     }
 }
 
-int main(void) {
+// prints the noise throughput of every backend the cpu supports
+void benchmarkNoise() {
+    const int batches = 1 << 18;
+    Noise noise(Consts::DEFAULT_SEED);
+    float x[Noise::BATCH], y[Noise::BATCH], z[Noise::BATCH], out[Noise::BATCH];
+    Noise::Backend best = Noise::backend();
+    for (Noise::Backend backend : {Noise::Backend::scalar, Noise::Backend::sse41, Noise::Backend::avx2}) {
+        if (!Noise::setBackend(backend))
+            continue;
+        float sum = 0.0f;
+        double samplesPerSec[2];
+        for (int dims = 2; dims <= 3; dims++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int b = 0; b < batches; b++) {
+                for (int i = 0; i < Noise::BATCH; i++) {
+                    x[i] = (b * Noise::BATCH + i) * 0.031f;
+                    y[i] = b * 0.017f;
+                    z[i] = i * 0.43f;
+                }
+                if (dims == 2)
+                    noise.simplex2(x, y, out);
+                else
+                    noise.simplex3(x, y, z, out);
+                sum += out[0];
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            samplesPerSec[dims - 2] = batches * Noise::BATCH / seconds;
+        }
+        std::cout << Noise::backendName(backend) << ": 2D " << samplesPerSec[0] * 1e-6 << " M samples/s, 3D "
+            << samplesPerSec[1] * 1e-6 << " M samples/s (checksum " << sum << ")" << std::endl;
+    }
+    Noise::setBackend(best);
+}
+
+// prints the compression ratio and speed of the chunk codec on generated terrain
+void benchmarkCodec() {
+    const int passes = 16;
+    TerrainGenerator generator(Consts::DEFAULT_SEED);
+    std::vector<ChunkStorage> chunks;
+    for (int z = -4; z < 4; z++) {
+        for (int y = -1; y < 3; y++) {
+            for (int x = -4; x < 4; x++) {
+                generator.generate({x, y, z}, chunks.emplace_back());
+            }
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> encoded(chunks.size());
+    size_t packedBytes = 0, encodedBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            ChunkCodec::encode(chunks[i], encoded[i]);
+        }
+    }
+    double encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < chunks.size(); i++) {
+        packedBytes += chunks[i].memoryUsage();
+        encodedBytes += encoded[i].size();
+    }
+
+    ChunkStorage decoded;
+    int mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (!ChunkCodec::decode(encoded[i].data(), encoded[i].size(), decoded)) {
+                mismatches++;
+            }
+        }
+    }
+    double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < chunks.size(); i++) {
+        ChunkCodec::decode(encoded[i].data(), encoded[i].size(), decoded);
+        for (int v = 0; v < Consts::CHUNK_SIZE_POW3; v++) {
+            if (!(decoded.get(v) == chunks[i].get(v))) {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    // speeds are of the uncompressed blocks
+    const double rawBytes = (double)chunks.size() * Consts::CHUNK_SIZE_POW3 * sizeof(Block);
+    const double MiB = 1024.0 * 1024.0;
+    std::cout << chunks.size() << " chunks: " << rawBytes / MiB << " MiB of blocks, " << packedBytes / MiB
+        << " MiB palette packed, " << encodedBytes / MiB << " MiB compressed" << std::endl;
+    std::cout << "ratio " << rawBytes / encodedBytes << "x to blocks, " << (double)packedBytes / encodedBytes
+        << "x to palette packed" << std::endl;
+    std::cout << "encode " << rawBytes * passes / encodeSeconds / MiB << " MiB/s, decode "
+        << rawBytes * passes / decodeSeconds / MiB << " MiB/s (" << mismatches << " mismatches)" << std::endl;
+}
+
+// prints how long bulk edits take on generated terrain next to the same box set block by block
+void benchmarkEdit() {
+    TerrainGenerator generator(Consts::DEFAULT_SEED);
+    auto generate = [&generator] {
+        for (int z = -8; z < 8; z++) {
+            for (int y = -2; y < 4; y++) {
+                for (int x = -8; x < 8; x++) {
+                    auto chunk = std::make_unique<ChunkStorage>();
+                    generator.generate({x, y, z}, *chunk);
+                    World::insertChunk({x, y, z}, std::move(chunk));
+                }
+            }
+        }
+    };
+    auto milliseconds = [](auto start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    const glm::ivec3 min(-100, 0, -100), max(99, 49, 99);
+    const Block stone = {Consts::BlockIDs::stone};
+    std::vector<glm::ivec3> modified, dirty;
+
+    generate();
+    auto start = std::chrono::steady_clock::now();
+    for (int z = min.z; z <= max.z; z++) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int x = min.x; x <= max.x; x++) {
+                World::setBlock(x, y, z, stone);
+            }
+        }
+    }
+    std::cout << "setBlock box 200x50x200: " << milliseconds(start) << " ms" << std::endl;
+
+    generate();
+    World::takeDirty(modified, dirty);
+    start = std::chrono::steady_clock::now();
+    int chunks = WorldEdit::fill(min, max, stone);
+    std::cout << "fill box 200x50x200: " << milliseconds(start) << " ms, " << chunks << " chunks" << std::endl;
+    start = std::chrono::steady_clock::now();
+    chunks = WorldEdit::fillSphere(glm::vec3(0.0f, 24.0f, 0.0f), 60.0f, {Consts::BlockIDs::air});
+    std::cout << "carve sphere r60: " << milliseconds(start) << " ms, " << chunks << " chunks" << std::endl;
+    Clipboard clipboard;
+    start = std::chrono::steady_clock::now();
+    WorldEdit::copy(glm::ivec3(-64, 0, -64), glm::ivec3(63, 63, 63), clipboard);
+    std::cout << "copy 128x64x128: " << milliseconds(start) << " ms" << std::endl;
+    for (int turns = 0; turns < 2; turns++) {
+        start = std::chrono::steady_clock::now();
+        chunks = WorldEdit::paste(clipboard, glm::ivec3(-60, 10, -70), turns);
+        std::cout << "paste 128x64x128 turned " << turns << " times: " << milliseconds(start) << " ms, " << chunks << " chunks" << std::endl;
+    }
+    World::takeDirty(modified, dirty);
+    std::cout << modified.size() << " chunks modified, " << dirty.size() << " dirty" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench-noise") == 0) {
+        benchmarkNoise();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-codec") == 0) {
+        benchmarkCodec();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-edit") == 0) {
+        benchmarkEdit();
+        return 0;
+    }
+
     /* Initialize the library */
     if (!glfwInit())
         return -1;
@@ -88,7 +258,7 @@ int main(void) {
 
     // my init
     Camera cam(s_state.win, (float)s_state.winSize.x/s_state.winSize.y);
-    cam.position = {14.5f, 15.0f, -16.0f};
+    cam.position = {14.5f, 50.0f, -16.0f};
     ShaderProgram basicShader("res/shaders/basic.vert", "res/shaders/basic.frag");
     glm::vec4 clearColor = {0.025, 0.770, 1.000, 1.0};
     glm::vec3 lightDir = {0.5f, 1.0f, 0.7f};
@@ -105,43 +275,19 @@ int main(void) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     // initialize opengl
-    int chunkSize = 8;
-    std::vector<Chunk*> chunks;
-    auto terrainStart     = std::chrono::steady_clock::now();
-    {
-        ZoneScopedN("Terrain Generation");
-        Block block = {1, true};
-        for (int z1 = 0; z1 < chunkSize; z1++) {
-            for (int x1 = 0; x1 < chunkSize; x1++) {
-                for (int z = 0; z < Consts::CHUNK_SIZE; z++) {
-                    for (int x = 0; x < Consts::CHUNK_SIZE; x++) {
-                        World::setBlock(x+x1*Consts::CHUNK_SIZE, 0, z+z1*Consts::CHUNK_SIZE, block);
-                    }
-                }
-            }
-        }
-    }
-    auto terrainEnd = std::chrono::steady_clock::now();
-    {
-        ZoneScopedN("Mesh Generation");
-        for (int z1 = 0; z1 < chunkSize; z1++) {
-            for (int x1 = 0; x1 < chunkSize; x1++) {
-                Chunk* chunk = new Chunk({x1*Consts::CHUNK_SIZE, 0, z1*Consts::CHUNK_SIZE});
-                chunk->remesh();
-                chunks.push_back(chunk);
-            }
-        }
-    }
-    auto meshEnd = std::chrono::steady_clock::now();
-    std::cout << "Terrain generation took " << std::chrono::duration_cast<std::chrono::milliseconds>(terrainEnd - terrainStart).count() << "ms" << std::endl;
-    std::cout << "Mesh generation took " << std::chrono::duration_cast<std::chrono::milliseconds>(meshEnd - terrainEnd).count() << "ms" << std::endl;
+    TerrainGenerator terrainGenerator(Consts::DEFAULT_SEED);
+    RegionStore regionStore("world");
+    // destroyed before the gl context, saves the world on the way
+    auto chunkManager = std::make_unique<ChunkManager>(terrainGenerator, &regionStore);
+    Raycaster raycaster;
     
-    Texture texture("res/dev.jpg", GL_RGB);
+    TextureArray blockTextures(TEXTURE_LAYER_PATHS, TEXTURE_LAYER_COUNT, GL_RGB);
     basicShader.bind();
     basicShader.set("u_texture", 0);
     basicShader.set("u_lightDir", lightDir);
 
 
+    float remeshTime = 0.0f;
     auto start     = std::chrono::steady_clock::now();
     auto lastFrame = std::chrono::steady_clock::now();
     /* Loop until the user closes the window */
@@ -166,12 +312,63 @@ int main(void) {
             changeDrawMode();
         }
         ImGui::DragFloat3("Position", &cam.position.x, 0.1f);
+        RaycastHit target;
+        if (raycaster.cast(cam.position, cam.front(), 64.0f, target)) {
+            ImGui::Text("Target: block %d at %d %d %d, face %d %d %d, %.1f away", target.block.id,
+                target.position.x, target.position.y, target.position.z,
+                target.normal.x, target.normal.y, target.normal.z, target.distance);
+        } else {
+            ImGui::Text("Target: none");
+        }
+        const char* meshingModes[] = {"Naive", "Bitmask", "Greedy"};
+        ImGui::Combo("Mesher", (int*)&s_state.meshingMode, meshingModes, IM_ARRAYSIZE(meshingModes));
+        if (ImGui::Button("Remesh")) {
+            ZoneScopedN("Remesh");
+            auto remeshStart = std::chrono::steady_clock::now();
+            chunkManager->remeshAll(s_state.meshingMode);
+            remeshTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - remeshStart).count() * 0.001;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%.2fms (%u threads)", remeshTime, ThreadPool::instance().size());
+        ImGui::Text("Chunks: %d loaded, %d meshed, %d pending, %d to remesh", chunkManager->loadedCount(), chunkManager->chunkCount(),
+            chunkManager->pendingCount(), chunkManager->remeshQueueSize());
+        if (ImGui::Button("Save")) {
+            chunkManager->save();
+        }
+        ImGui::SameLine();
+        ImGui::Text("%d unsaved chunks, %d regions open, %d reading (%s)", chunkManager->unsavedCount(), regionStore.openRegions(),
+            chunkManager->readingCount(), IOBackend::kindName(chunkManager->io()->backend()));
+        ImGui::Checkbox("Frustum culling", &s_state.cullFrustum);
+        ImGui::SameLine();
+        ImGui::Text("%d visible, %d culled, %d draw calls", chunkManager->visibleCount(), chunkManager->culledCount(), chunkManager->drawCalls());
+        MeshArena::Stats arena = chunkManager->arenaStats();
+        const float quadMiB = MeshArena::BYTES_PER_QUAD / (1024.0f * 1024.0f);
+        ImGui::Text("Mesh arena: %d pages, %.1f/%.1f MiB used (%.1f reserved), %.0f%% fragmented, %zu free ranges",
+            arena.pages, arena.used * quadMiB, arena.capacity * quadMiB, arena.reserved * quadMiB,
+            arena.fragmentation * 100.0f, arena.freeRanges);
+        bool compressFar = chunkManager->compressFar();
+        if (ImGui::Checkbox("Compress far chunks", &compressFar)) {
+            chunkManager->setCompressFar(compressFar);
+        }
+        ImGui::SameLine();
+        ImGui::Text("%d chunks, %.2f MiB", chunkManager->compressedCount(), chunkManager->compressedBytes() / (1024.0f * 1024.0f));
+        const SparseVoxelOctree& farField = chunkManager->farField();
+        ImGui::Text("Far field: %zu nodes, %.1f MiB", farField.nodeCount(), farField.memoryUsage() / (1024.0f * 1024.0f));
+        const StagingRing& staging = chunkManager->staging();
+        if (staging.isSupported()) {
+            ImGui::Text("Staging ring: %.1f/%.1f MiB in flight", staging.inFlight() / (1024.0f * 1024.0f),
+                staging.capacity() / (1024.0f * 1024.0f));
+        } else {
+            ImGui::Text("Staging ring: unsupported, uploading with glBufferSubData");
+        }
+
+        chunkManager->update(cam.position);
 
 
         /* Render here */
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        texture.bind(0);
+        blockTextures.bind(0);
 
         basicShader.bind();
         basicShader.set("u_color", 1.0f, 1.0f, 0.0f);
@@ -179,9 +376,8 @@ int main(void) {
 
         // rectangle.draw();
         // mesh.draw();
-        for (Chunk* chunk : chunks) {
-            chunk->draw();
-        }
+        Frustum frustum(cam.viewProjection);
+        chunkManager->draw(s_state.cullFrustum ? &frustum : nullptr);
 
         basicShader.refresh();
 
@@ -203,6 +399,8 @@ int main(void) {
     }
 
     s_state.shouldWindowClose = true;
+    chunkManager.reset();
+    QuadIndexBuffer::remove();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();